@@ -0,0 +1,56 @@
+// analysis_scope.h
+#ifndef ANALYSIS_SCOPE_H
+#define ANALYSIS_SCOPE_H
+
+#include <clang/Basic/SourceLocation.h>
+#include <llvm/ADT/DenseMap.h>
+#include <llvm/Support/GlobPattern.h>
+#include <string>
+#include <vector>
+
+namespace clang {
+    class Decl;
+    class SourceManager;
+}
+
+// Which function definitions get a CFG. One policy is shared by CFGVisitor, Parser's
+// function listing, CFGGenerationConsumer and AnalysisSession, so they all agree on it.
+struct AnalysisScope {
+    enum class Mode {
+        MainFile,            // only the file being compiled
+        ProjectDirectories,  // the main file plus anything under projectDirectories
+        AllFiles
+    };
+
+    Mode mode = Mode::MainFile;
+    std::vector<std::string> projectDirectories;  // empty means the main file's directory
+    std::vector<std::string> includeGlobs;        // extra files to analyze, matched on the full path
+    std::vector<std::string> excludeGlobs;        // always skipped, the main file included
+    bool includeSystemHeaders = false;
+
+    // Process-wide scope used by all analysis entry points
+    static AnalysisScope current();
+    static void setCurrent(const AnalysisScope& scope);
+
+    // Per-TU view of a scope. The decision is made once per file, so checking every
+    // declaration is cheap, and visitors can skip whole out-of-scope subtrees.
+    class Filter {
+    public:
+        Filter(const AnalysisScope& scope, const clang::SourceManager& SM);
+
+        bool contains(const clang::Decl* D);
+        bool contains(clang::SourceLocation loc);
+
+    private:
+        bool fileInScope(clang::FileID file);
+
+        AnalysisScope m_scope;
+        const clang::SourceManager& m_sourceManager;
+        std::vector<llvm::GlobPattern> m_includeGlobs;
+        std::vector<llvm::GlobPattern> m_excludeGlobs;
+        std::vector<std::string> m_directories;
+        llvm::DenseMap<clang::FileID, bool> m_files;
+    };
+};
+
+#endif // ANALYSIS_SCOPE_H
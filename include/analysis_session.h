@@ -0,0 +1,81 @@
+// analysis_session.h
+#ifndef ANALYSIS_SESSION_H
+#define ANALYSIS_SESSION_H
+
+#include <clang/Frontend/ASTUnit.h>
+#include <clang/Tooling/CompilationDatabase.h>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace clang {
+    class ASTContext;
+    class FunctionDecl;
+}
+
+namespace GraphGenerator {
+    class CFGGraph;
+    class StatementPool;
+}
+
+namespace CFGAnalyzer {
+
+    // Keeps one parsed TU alive together with an index of its function definitions, so
+    // single-function CFGs can be built on demand without re-parsing. Functions are keyed
+    // by USR, which keeps overloads apart. All methods are thread-safe.
+    class AnalysisSession {
+    public:
+        struct FunctionEntry {
+            std::string usr;
+            std::string name;       // qualified name
+            std::string signature;  // qualified name with parameter types
+            unsigned line = 0;
+            uint64_t bodyHash = 0;  // hash of the definition's source text
+        };
+
+        // Process-wide session for a file, so every action on it shares one parse.
+        // The few most recently used sessions are kept.
+        static std::shared_ptr<AnalysisSession> forFile(const std::string& filename);
+
+        // Parses the file unless it is already open and unchanged on disk. Null compilations
+        // keep whatever database the session was opened with.
+        bool open(const std::string& filename,
+                  std::shared_ptr<const clang::tooling::CompilationDatabase> compilations = nullptr);
+        void close();
+        bool isOpen() const;
+        std::string filename() const;
+
+        std::vector<FunctionEntry> functions() const;
+
+        // Definitions whose qualified or unqualified name matches, case-insensitively
+        std::vector<FunctionEntry> findFunctions(const std::string& name) const;
+
+        // CFG of a single function, built on first request and kept for later ones
+        std::shared_ptr<GraphGenerator::CFGGraph> functionCFG(const std::string& usr);
+
+        // Runs fn on the parsed ASTContext with the session locked, so fn must not call back
+        // into the session. Returns false if nothing is open.
+        bool withContext(const std::function<void(clang::ASTContext&)>& fn);
+
+    private:
+        void buildIndex();
+
+        mutable std::mutex m_mutex;
+        std::string m_filename;
+        std::shared_ptr<const clang::tooling::CompilationDatabase> m_compilations;
+        uint64_t m_contentHash = 0;  // of the file when it was parsed
+        std::unique_ptr<clang::ASTUnit> m_ast;
+        std::vector<FunctionEntry> m_functions;
+        std::unordered_map<std::string, const clang::FunctionDecl*> m_declsByUSR;
+        std::unordered_multimap<std::string, size_t> m_functionsByName;
+        std::unordered_map<std::string, std::shared_ptr<GraphGenerator::CFGGraph>> m_cfgs;
+        std::shared_ptr<GraphGenerator::StatementPool> m_statements;  // shared by m_cfgs
+    };
+
+} // namespace CFGAnalyzer
+
+#endif // ANALYSIS_SESSION_H
@@ -0,0 +1,74 @@
+// ast_cache.h
+#ifndef AST_CACHE_H
+#define AST_CACHE_H
+
+#include <clang/Frontend/ASTUnit.h>
+#include <clang/Tooling/ArgumentsAdjusters.h>
+#include <clang/Tooling/CompilationDatabase.h>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace clang {
+    class PCHContainerOperations;
+}
+
+// Process-wide on-disk cache of serialized ASTUnits. An entry is keyed by the clang
+// version, the compile command and the main file's contents, and is only used while
+// every file the TU included still hashes the same. The directory may be shared by
+// several processes; it is trimmed back under maxSize by evicting the least recently
+// used entries. The directory is only scanned once to learn its size, and again when
+// stores push the running total over maxSize.
+class ASTCache {
+public:
+    static ASTCache& instance();
+
+    void setEnabled(bool enabled);
+    bool isEnabled() const;
+
+    // Defaults to <system temp>/cfgparser-ast
+    void setCacheDirectory(const std::string& directory);
+    std::string cacheDirectory() const;
+
+    // Total size of the cache directory in bytes, 1 GiB by default
+    void setMaxSize(uint64_t bytes);
+    uint64_t maxSize() const;
+
+    // Cached AST for the file's compile command, or nullptr on a miss
+    std::unique_ptr<clang::ASTUnit> load(const clang::tooling::CompilationDatabase& compilations,
+                                         const std::string& file);
+
+    // Cached AST if there is one, otherwise builds it with ClangTool (using the given
+    // adjusters) and stores it. Returns nullptr only if the AST could not be built.
+    std::unique_ptr<clang::ASTUnit> loadOrBuild(const clang::tooling::CompilationDatabase& compilations,
+                                                const std::string& file,
+                                                const std::vector<clang::tooling::ArgumentsAdjuster>& adjusters);
+
+    // Rescans the directory and removes least recently used entries until it fits in maxSize
+    void evict();
+
+private:
+    ASTCache();
+
+    std::string keyFor(const clang::tooling::CompileCommand& command) const;
+    std::string entryPath(const std::string& key) const;
+    bool inputsUnchanged(const std::string& manifestPath) const;
+    bool store(clang::ASTUnit& unit, const std::string& key, uint64_t& bytes);
+    void noteStored(uint64_t bytes);
+    void scanAndTrim();  // m_evictMutex held
+
+    bool m_enabled;
+    std::string m_directory;
+    uint64_t m_maxSize;
+    std::shared_ptr<clang::PCHContainerOperations> m_pchOperations;
+    mutable std::mutex m_mutex;
+    std::mutex m_evictMutex;
+    // Size of the directory as of the last scan plus what was stored since; entries
+    // other processes add are only seen by the next scan
+    uint64_t m_totalSize;
+    bool m_sizeKnown;
+};
+
+#endif // AST_CACHE_H
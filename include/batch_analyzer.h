@@ -0,0 +1,54 @@
+// batch_analyzer.h
+#ifndef BATCH_ANALYZER_H
+#define BATCH_ANALYZER_H
+
+#include "cfg_analyzer.h"
+#include <clang/Tooling/CompilationDatabase.h>
+#include <memory>
+#include <set>
+#include <string>
+#include <vector>
+
+namespace CFGAnalyzer {
+
+    // Spreads translation units over a pool of worker threads. Each worker keeps one
+    // Parser::ThreadLocalState (CompilerInstance + FileManager) for all the TUs it takes,
+    // and per-TU results are merged into the shared result as soon as a TU finishes.
+    class BatchAnalyzer {
+    public:
+        explicit BatchAnalyzer(unsigned workerCount = 0);
+
+        // 0 means one worker per hardware thread
+        void setWorkerCount(unsigned workerCount);
+        unsigned workerCount() const;
+
+        void setCompilationDatabase(std::shared_ptr<const clang::tooling::CompilationDatabase> compilations);
+        void setOutputDirectory(const std::string& outputDir);
+        void setProgressCallback(ProgressCallback callback);
+        // Misses are built as ASTUnits and saved to the ASTCache, instead of on the
+        // worker's CompilerInstance. Off by default; cache hits are used either way.
+        void setPopulateASTCache(bool populate);
+        // Outputs are submitted with the run's ticket and go into its bundle, if any; the
+        // caller flushes and finishes them. The registry is always the batch's own.
+        void setRunContext(const RunContext& run);
+
+        // Fills functionDependencies and functionCFGs; formatting is left to the caller
+        AnalysisResult analyzeFiles(const std::vector<std::string>& sources);
+
+    private:
+        // A CFG whose name already has a different one (e.g. a static function in several
+        // TUs) is kept as "<name> (<file>)", and the name goes into collisions
+        void mergeResult(AnalysisResult& into, AnalysisResult&& from, const std::string& source,
+                         std::set<std::string>& collisions);
+
+        unsigned m_workerCount;
+        std::string m_outputDir;
+        std::shared_ptr<const clang::tooling::CompilationDatabase> m_compilations;
+        ProgressCallback m_progress;
+        bool m_populateASTCache;
+        RunContext m_run;
+    };
+
+} // namespace CFGAnalyzer
+
+#endif // BATCH_ANALYZER_H
@@ -6,37 +6,85 @@
 #include <clang/AST/RecursiveASTVisitor.h>
 #include <clang/Frontend/CompilerInstance.h>
 #include <clang/Frontend/FrontendAction.h>
+#include <clang/Tooling/CompilationDatabase.h>
+#include "analysis_scope.h"
+#include "parser.h"
 #include <QString>
 #include <QMutex>
+#include <cstdint>
 #include <string>
 #include <unordered_map>
 #include <set>
 #include <memory>
+#include <functional>
+
+class CFGRegistry;
+class OutputTicket;
+
+namespace GraphGenerator {
+    class BundleWriter;
+    class CFGGraph;
+    class StatementPool;
+}
 
 namespace CFGAnalyzer {
 
+    // The graphs are built once and shared read-only with whoever shows them; DOT and
+    // JSON text is only produced on export (CFGAnalyzer::generateDotOutput/JsonOutput).
+    // Report, DOT and JSON list functions in name order and depend on the input only.
     struct AnalysisResult {
-        std::string dotOutput;
-        std::string jsonOutput;
         std::string report;
-        bool success;
+        bool success = false;
         std::unordered_map<std::string, std::set<std::string>> functionDependencies;
+        std::shared_ptr<const GraphGenerator::CFGGraph> callGraph;
+        std::unordered_map<std::string, std::shared_ptr<const GraphGenerator::CFGGraph>> functionCFGs;
+        // Same for the same dependencies and CFGs, whatever the run (see contentHash below)
+        uint64_t contentHash = 0;
+        // Run metadata, kept out of the outputs above
+        std::string generatedAt;
+    };
+
+    // One node per function, labelled with its name and numbered in name order, and an
+    // edge from each caller to each callee
+    std::shared_ptr<const GraphGenerator::CFGGraph> buildCallGraph(
+        const std::unordered_map<std::string, std::set<std::string>>& functionDependencies);
+
+    // xxHash64 over the dependencies and each function's CFGGraph::contentHash, in name
+    // order, so a later step can skip a result it has already seen
+    uint64_t contentHash(const AnalysisResult& result);
+
+    // Progress of a multi-TU run; called from worker threads after every TU
+    using ProgressCallback = std::function<void(const std::string& file, bool ok,
+                                                size_t done, size_t total)>;
+
+    // What the TUs of one analysis run share; each part is optional
+    struct RunContext {
+        std::shared_ptr<OutputTicket> outputs;                 // the run's OutputWriter jobs
+        std::shared_ptr<GraphGenerator::BundleWriter> bundle;  // per-function DOT goes here
+        CFGRegistry* registry = nullptr;                       // shares header CFGs
     };
 
+    class AnalysisSession;
     class CFGConsumer;  // Forward declaration
     class CFGAction;    // Forward declaration
 
+    // Per-function DOT goes into the run's bundle if there is one, else into
+    // <outputDir>/<name>_cfg.dot. Header functions are shared through the run's registry.
     class CFGVisitor : public clang::RecursiveASTVisitor<CFGVisitor> {
     public:
         explicit CFGVisitor(clang::ASTContext* Context,
                          const std::string& outputDir,
-                         AnalysisResult& results);
+                         AnalysisResult& results,
+                         const RunContext& run = RunContext());
         
+        // Declarations outside the analysis scope are skipped with everything inside them
+        bool TraverseDecl(clang::Decl* D);
         bool VisitFunctionDecl(clang::FunctionDecl* FD);
         bool VisitCallExpr(clang::CallExpr* CE);
         void PrintFunctionDependencies() const;
         std::unordered_map<std::string, std::set<std::string>> GetFunctionDependencies() const;
-        void FinalizeCombinedFile();
+        // Merges this TU's call dependencies into the shared result
+        void FinalizeResults();
         
         AnalysisResult& getResults() { return m_results; }
         
@@ -45,6 +93,9 @@ namespace CFGAnalyzer {
         std::string OutputDir;
         std::string CurrentFunction;
         AnalysisResult& m_results;
+        RunContext Run;
+        AnalysisScope::Filter Scope;
+        std::shared_ptr<GraphGenerator::StatementPool> Statements;  // one per TU
         std::unordered_map<std::string, std::set<std::string>> FunctionDependencies;
     };
 
@@ -52,7 +103,8 @@ namespace CFGAnalyzer {
     public:
         CFGConsumer(clang::ASTContext* Context,
                   const std::string& outputDir,
-                  AnalysisResult& results);
+                  AnalysisResult& results,
+                  const RunContext& run = RunContext());
         
         void HandleTranslationUnit(clang::ASTContext& Context) override;
         
@@ -63,7 +115,8 @@ namespace CFGAnalyzer {
     class CFGAction : public clang::ASTFrontendAction {
     public:
         CFGAction(const std::string& outputDir,
-                AnalysisResult& results);
+                AnalysisResult& results,
+                const RunContext& run = RunContext());
         
         std::unique_ptr<clang::ASTConsumer> CreateASTConsumer(
             clang::CompilerInstance& CI, llvm::StringRef File) override;
@@ -71,6 +124,7 @@ namespace CFGAnalyzer {
     private:
         std::string OutputDir;
         AnalysisResult& m_results;
+        RunContext Run;
     };
 
     class CFGAnalyzer {
@@ -80,17 +134,65 @@ namespace CFGAnalyzer {
     
         AnalysisResult analyzeFile(const QString& filePath);
         AnalysisResult analyze(const std::string& filename);
+
+        // Same as above, on the AST an open session already holds (no parse)
+        AnalysisResult analyzeFile(AnalysisSession& session);
+        AnalysisResult analyze(AnalysisSession& session);
+
+        // Use each TU's own flags from compile_commands.json (the file or its directory)
+        bool loadCompilationDatabase(const std::string& path, std::string& errorMessage);
+        void setCompilationDatabase(std::shared_ptr<const clang::tooling::CompilationDatabase> compilations);
+
+        // Whole-project mode: analyze every TU listed in the compilation database
+        AnalysisResult analyzeProject();
+
+        // Analyzes in-memory editor buffers. The AST is kept between calls and reparsed,
+        // so repeated calls for the same file reuse its precompiled preamble.
+        AnalysisResult analyzeUnsaved(const std::string& filename,
+                                      const Parser::UnsavedFiles& unsavedFiles);
+
+        // Runs the TUs on a BatchAnalyzer worker pool (0 workers = one per core)
+        AnalysisResult analyzeFiles(const std::vector<std::string>& sources);
+        void setWorkerCount(unsigned workerCount) { m_workerCount = workerCount; }
+        void setProgressCallback(ProgressCallback callback) { m_progress = std::move(callback); }
+        // See BatchAnalyzer::setPopulateASTCache
+        void setPopulateASTCache(bool populate) { m_populateASTCache = populate; }
+
+        // Text forms of a result, for export. JSON is compact unless setPrettyJson is set.
+        std::string generateDotOutput(const AnalysisResult& result) const;
+        std::string generateJsonOutput(const AnalysisResult& result, const std::string& filename) const;
+        void setPrettyJson(bool pretty) { m_prettyJson = pretty; }
+
+        // Per-function DOT of this analyzer's runs goes into one indexed .cfgbundle at path
+        // (replaced every run) instead of a <name>_cfg.dot file each; empty path restores
+        // the separate files
+        void setOutputBundle(const std::string& path, bool compress = false) {
+            m_bundlePath = path;
+            m_compressBundle = compress;
+        }
     
         void lock() { m_analysisMutex.lock(); }
         void unlock() { m_analysisMutex.unlock(); }
     
     private:
-        std::string generateDotOutput(const AnalysisResult& result) const;
+        AnalysisResult analyzeSources(const std::vector<std::string>& sources);
+        void collectResults(AnalysisResult& result, const RunContext& run) const;
+        // A new run's ticket, and its bundle unless there is none or it cannot be written
+        RunContext beginOutput() const;
+        void finishOutput(AnalysisResult& result, const RunContext& run) const;
         std::string generateReport(const AnalysisResult& result) const;
         static std::string getCurrentDateTime();
         
         mutable QMutex m_analysisMutex;
         AnalysisResult m_results;
+        std::shared_ptr<const clang::tooling::CompilationDatabase> m_compilations;
+        unsigned m_workerCount = 0;
+        ProgressCallback m_progress;
+        bool m_populateASTCache = false;
+        bool m_prettyJson = false;
+        std::string m_bundlePath;
+        bool m_compressBundle = false;
+        Parser m_liveParser;
     };    
 } // namespace CFGAnalyzer
 #endif // CFG_ANALYZER_H
\ No newline at end of file
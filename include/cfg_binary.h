@@ -0,0 +1,126 @@
+// cfg_binary.h
+#ifndef CFG_BINARY_H
+#define CFG_BINARY_H
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+class QFile;
+
+namespace GraphGenerator {
+    class CFGGraph;
+
+    // Versioned binary CFG container (.cfgb), laid out so a mapped file is read in place:
+    //
+    //   Header | FunctionRecord[functionCount] | NodeRecord[nodeCount]
+    //          | EdgeRecord[edgeCount] | TextRef[statementCount] | string bytes
+    //
+    // Functions are sorted by name and each owns a run of nodes; each node owns a run of
+    // edges (its successors, sorted) and of statements. Every record is a multiple of
+    // 8 bytes, so all arrays stay aligned. Strings are stored once. The checksum is
+    // xxHash64 of everything after the header. Files are written in host byte order,
+    // which the header records.
+    namespace BinaryCFG {
+        constexpr char Magic[4] = {'C', 'F', 'G', 'B'};
+        constexpr uint32_t Version = 1;
+        constexpr uint32_t ByteOrderMark = 0x01020304;
+        constexpr const char* FileSuffix = ".cfgb";
+
+        struct TextRef {
+            uint32_t offset;  // into the string bytes
+            uint32_t length;
+        };
+
+        struct Header {
+            char magic[4];
+            uint32_t version;
+            uint32_t byteOrder;
+            uint32_t functionCount;
+            uint64_t nodeCount;
+            uint64_t edgeCount;
+            uint64_t statementCount;
+            uint64_t stringBytes;
+            uint64_t checksum;
+        };
+
+        struct FunctionRecord {
+            TextRef name;
+            uint32_t firstNode;
+            uint32_t nodeCount;
+        };
+
+        struct NodeRecord {
+            int32_t id;
+            uint32_t line;
+            TextRef label;
+            uint32_t firstEdge;
+            uint32_t edgeCount;
+            uint32_t firstStatement;
+            uint32_t statementCount;
+            uint8_t flags;  // CFGGraph::NodeFlag bits
+            uint8_t padding[7];
+        };
+
+        struct EdgeRecord {
+            int32_t target;  // node ID
+            uint32_t flags;  // CFGGraph::EdgeFlag bits
+        };
+
+        static_assert(sizeof(Header) == 56, "unexpected Header layout");
+        static_assert(sizeof(FunctionRecord) == 16, "unexpected FunctionRecord layout");
+        static_assert(sizeof(NodeRecord) == 40, "unexpected NodeRecord layout");
+        static_assert(sizeof(EdgeRecord) == 8, "unexpected EdgeRecord layout");
+        static_assert(sizeof(TextRef) == 8, "unexpected TextRef layout");
+    }
+
+    // Writes the functions' CFGs to one binary file, replacing it atomically.
+    // False if the file cannot be written or the graphs exceed the format's 32-bit limits.
+    bool writeBinaryCFGFile(const std::string& filename,
+                            const std::vector<std::pair<std::string, const CFGGraph*>>& functions);
+
+    // Read-only, memory-mapped view of a .cfgb file. Opening checks the header and the
+    // checksum; nothing is parsed or copied, records are read straight from the mapping.
+    class BinaryCFGFile {
+    public:
+        ~BinaryCFGFile();
+
+        // nullptr, with a reason in error, if the file is missing or not a valid .cfgb
+        static std::shared_ptr<const BinaryCFGFile> open(const std::string& filename,
+                                                         std::string* error = nullptr);
+
+        size_t functionCount() const { return m_header->functionCount; }
+        const BinaryCFG::FunctionRecord& function(size_t index) const { return m_functions[index]; }
+        std::string_view functionName(size_t index) const { return text(m_functions[index].name); }
+        // Index of the function with exactly this name, -1 if none
+        int findFunction(std::string_view name) const;
+
+        size_t nodeCount() const { return m_header->nodeCount; }
+        size_t edgeCount() const { return m_header->edgeCount; }
+        const BinaryCFG::NodeRecord* nodes() const { return m_nodes; }
+        const BinaryCFG::EdgeRecord* edges() const { return m_edges; }
+
+        // Views into the mapping; empty for references outside the string bytes
+        std::string_view text(const BinaryCFG::TextRef& ref) const;
+        std::string_view statement(uint32_t index) const;
+
+        // Copies one function into a CFGGraph, for code that works on graphs
+        std::unique_ptr<CFGGraph> toGraph(size_t function) const;
+
+    private:
+        BinaryCFGFile() = default;
+
+        std::unique_ptr<QFile> m_file;
+        const BinaryCFG::Header* m_header = nullptr;
+        const BinaryCFG::FunctionRecord* m_functions = nullptr;
+        const BinaryCFG::NodeRecord* m_nodes = nullptr;
+        const BinaryCFG::EdgeRecord* m_edges = nullptr;
+        const BinaryCFG::TextRef* m_statements = nullptr;
+        const char* m_strings = nullptr;
+    };
+}
+
+#endif // CFG_BINARY_H
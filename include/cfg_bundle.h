@@ -0,0 +1,144 @@
+// cfg_bundle.h
+#ifndef CFG_BUNDLE_H
+#define CFG_BUNDLE_H
+
+#include "cfg_binary.h"
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_set>
+#include <vector>
+
+class QFile;
+
+namespace GraphGenerator {
+
+    // Single-file container for per-function outputs (.cfgbundle), in place of a
+    // directory of <name>_cfg.dot files:
+    //
+    //   Header | blob ... | IndexRecord[entryCount] | string bytes | Trailer
+    //
+    // Blobs are stored in index order (name, kind, USR), so the same entries give the same
+    // file whatever order they were produced in. The fixed-size trailer at the end of the
+    // file says where the index is, so a reader gets to any entry with one seek. Entries
+    // are keyed by USR as well as name, so overloads do not collide. Each blob may be
+    // stored qCompress'ed; its hash is xxHash64 of the uncompressed content, so it names
+    // the content however it is stored.
+    namespace Bundle {
+        constexpr char Magic[4] = {'C', 'F', 'G', 'X'};
+        constexpr uint32_t Version = 1;
+        constexpr uint32_t ByteOrderMark = 0x01020304;
+        constexpr const char* FileSuffix = ".cfgbundle";
+
+        enum class EntryKind : uint32_t { Dot = 1, Json = 2, BinaryCFG = 3 };
+        constexpr uint32_t CompressedEntry = 1;  // IndexRecord::flags
+
+        struct Header {
+            char magic[4];
+            uint32_t version;
+        };
+
+        struct IndexRecord {
+            uint64_t offset;           // of the stored blob
+            uint64_t storedLength;
+            uint64_t length;           // uncompressed
+            uint64_t hash;
+            BinaryCFG::TextRef name;   // into the string bytes
+            BinaryCFG::TextRef usr;
+            uint32_t kind;
+            uint32_t flags;
+        };
+
+        struct Trailer {
+            uint64_t indexOffset;
+            uint64_t entryCount;
+            uint64_t stringBytes;
+            uint64_t checksum;  // xxHash64 of the index records and string bytes
+            uint32_t byteOrder;
+            char magic[4];
+        };
+
+        static_assert(sizeof(Header) == 8, "unexpected Header layout");
+        static_assert(sizeof(IndexRecord) == 56, "unexpected IndexRecord layout");
+        static_assert(sizeof(Trailer) == 40, "unexpected Trailer layout");
+    }
+
+    // Spools entries to "<filename>.spool.tmp" as they arrive; finish() copies them in
+    // index order into "<filename>.tmp", adds the index and renames it over filename.
+    // Not thread-safe.
+    class BundleWriter {
+    public:
+        // compressEntries is what the bundle's producers are asked to pass to add()
+        explicit BundleWriter(const std::string& filename, bool compressEntries = false);
+        // A bundle that was not finished is discarded
+        ~BundleWriter();
+
+        BundleWriter(const BundleWriter&) = delete;
+        BundleWriter& operator=(const BundleWriter&) = delete;
+
+        bool isOpen() const { return m_out.is_open() && !m_failed; }
+        bool compressEntries() const { return m_compressEntries; }
+        const std::string& filename() const { return m_filename; }
+
+        // An entry with the same kind and USR (the name, if there is no USR) as an earlier
+        // one is skipped, so a header function seen from several TUs is stored once
+        bool add(std::string_view name, std::string_view usr, Bundle::EntryKind kind,
+                 std::string_view content, bool compress = false);
+        bool finish();
+
+    private:
+        struct Pending {
+            std::string name;
+            std::string usr;
+            Bundle::IndexRecord record;
+        };
+
+        std::string m_filename;
+        std::string m_spoolPath;
+        std::string m_tempPath;
+        std::ofstream m_out;     // the spool
+        uint64_t m_offset = 0;   // of the next blob in the spool
+        std::vector<Pending> m_entries;
+        std::unordered_set<std::string> m_keys;
+        bool m_compressEntries;
+        bool m_failed = false;
+        bool m_finished = false;
+    };
+
+    // Read-only, memory-mapped bundle. Opening checks the trailer and the index; blobs
+    // are only touched, and their hashes checked, when read.
+    class BundleFile {
+    public:
+        ~BundleFile();
+
+        // nullptr, with a reason in error, if the file is missing or not a valid bundle
+        static std::shared_ptr<const BundleFile> open(const std::string& filename,
+                                                      std::string* error = nullptr);
+
+        size_t entryCount() const { return m_trailer->entryCount; }
+        const Bundle::IndexRecord& entry(size_t index) const { return m_index[index]; }
+        std::string_view name(size_t index) const { return text(m_index[index].name); }
+        std::string_view usr(size_t index) const { return text(m_index[index].usr); }
+
+        // First entry of the kind with this name, -1 if none; overloads follow it in USR order
+        int find(std::string_view name, Bundle::EntryKind kind) const;
+        int findByUsr(std::string_view usr, Bundle::EntryKind kind) const;
+
+        // Uncompressed content; false if the entry cannot be inflated or fails its hash
+        bool read(size_t index, std::string& content) const;
+
+    private:
+        BundleFile() = default;
+        std::string_view text(const BinaryCFG::TextRef& ref) const;
+
+        std::unique_ptr<QFile> m_file;
+        const char* m_data = nullptr;
+        const Bundle::Trailer* m_trailer = nullptr;
+        const Bundle::IndexRecord* m_index = nullptr;
+        const char* m_strings = nullptr;
+    };
+}
+
+#endif // CFG_BUNDLE_H
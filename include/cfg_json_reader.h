@@ -0,0 +1,25 @@
+// cfg_json_reader.h
+#ifndef CFG_JSON_READER_H
+#define CFG_JSON_READER_H
+
+#include <string>
+#include <string_view>
+
+namespace GraphGenerator {
+    class CFGGraph;
+
+    // Reads the document CFGGraph::writeToJsonFile writes ("nodes" keyed by ID, "edges"
+    // with source/target) into graph, in one SAX pass with no document tree. The older
+    // form with a "nodes" array and from/to edges is accepted too; "ast", "functionCalls"
+    // and unknown members are skipped. idOffset is added to every node ID, so several
+    // documents can be read into one graph without their IDs colliding.
+    // False (with the reason in *error) if the text is not valid JSON; what was read
+    // before the error stays in the graph.
+    bool readJsonCFG(std::string_view document, CFGGraph& graph, int idOffset = 0,
+                     std::string* error = nullptr);
+    // Same, reading from the mapped file
+    bool readJsonCFGFile(const std::string& filename, CFGGraph& graph, int idOffset = 0,
+                         std::string* error = nullptr);
+}
+
+#endif // CFG_JSON_READER_H
@@ -0,0 +1,86 @@
+// cfg_registry.h
+#ifndef CFG_REGISTRY_H
+#define CFG_REGISTRY_H
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+namespace clang {
+    class FunctionDecl;
+}
+
+namespace GraphGenerator {
+    class CFGGraph;
+    class StatementPool;
+}
+
+// CFGs built during one analysis run, which owns the registry and hands it to each TU's
+// CFGVisitor. A definition is identified by its USR, where it is written and a hash of
+// its source text, so an inline or template function from a header gets one CFG no
+// matter how many TUs of the run include it.
+class CFGRegistry {
+public:
+    CFGRegistry() = default;
+
+    CFGRegistry(const CFGRegistry&) = delete;
+    CFGRegistry& operator=(const CFGRegistry&) = delete;
+
+    // Empty if no USR can be generated for the declaration
+    static std::string keyFor(const clang::FunctionDecl* FD);
+
+    // Shared CFG for the definition, built on the first request only. Safe to call from
+    // several threads; concurrent requests for the same key wait for one build. The
+    // statements of a new graph are interned into the caller's pool.
+    std::shared_ptr<const GraphGenerator::CFGGraph> getOrBuild(
+        const std::string& key,
+        const clang::FunctionDecl* FD,
+        std::shared_ptr<GraphGenerator::StatementPool> statements = nullptr);
+
+    size_t size() const;
+
+private:
+    struct Entry {
+        std::mutex buildMutex;
+        bool built = false;
+        std::shared_ptr<const GraphGenerator::CFGGraph> graph;
+    };
+
+    mutable std::mutex m_mutex;
+    std::unordered_map<std::string, std::shared_ptr<Entry>> m_entries;
+};
+
+// Process-wide record of which definition (CFGRegistry::keyFor) each output file holds,
+// so a file is written once. It can optionally be kept on disk, so later runs skip
+// rewriting unchanged files as well.
+class CFGOutputIndex {
+public:
+    static CFGOutputIndex& instance();
+
+    // True if the caller should write the definition to path, i.e. path does not already
+    // hold it and no one is writing it yet. The caller then reports with outputWritten.
+    bool claimOutput(const std::string& key, const std::string& path);
+    // Only a written claim is recorded as holding the key; a failed one is dropped
+    void outputWritten(const std::string& key, const std::string& path, bool written);
+
+    // Persistent index ("<key>\t<path>" per line) of the written outputs; empty path
+    // disables it
+    void setIndexFile(const std::string& path);
+    bool saveIndex();
+
+private:
+    CFGOutputIndex() = default;
+
+    struct Output {
+        std::string key;
+        bool pending;  // claimed, not written yet
+    };
+
+    std::mutex m_mutex;
+    std::unordered_map<std::string, Output> m_outputs;  // by path
+    std::string m_indexFile;
+    bool m_indexDirty = false;
+};
+
+#endif // CFG_REGISTRY_H
@@ -0,0 +1,39 @@
+// compile_commands.h
+#ifndef COMPILE_COMMANDS_H
+#define COMPILE_COMMANDS_H
+
+#include <clang/Tooling/ArgumentsAdjusters.h>
+#include <clang/Tooling/CompilationDatabase.h>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace CompileCommands {
+
+    using Database = clang::tooling::CompilationDatabase;
+
+    // Flags used for files that have no entry in a compilation database
+    const std::vector<std::string>& defaultArguments();
+
+    // Loads a compile_commands.json; path may be the file itself or the directory holding it
+    std::shared_ptr<const Database> load(const std::string& path, std::string& errorMessage);
+
+    // Looks for compile_commands.json next to the file, in a build/ sibling, or in any parent
+    // directory. Returns an empty string if nothing is found.
+    std::string discover(const std::string& sourceFile);
+
+    // Adds -resource-dir so clang's builtin headers are found from a non-clang executable
+    clang::tooling::ArgumentsAdjuster resourceDirAdjuster();
+
+    // Database to hand to ClangTool: the given one, with defaultArguments() for files it lacks
+    std::shared_ptr<const Database> orDefault(std::shared_ptr<const Database> compilations);
+
+    // Full driver command line (compiler, flags, source file) for a translation unit,
+    // adjusted for a syntax-only run. Falls back to defaultArguments() when the file is unknown.
+    std::vector<std::string> commandLineForFile(const Database* compilations,
+                                                const std::string& filename,
+                                                std::string* workingDirectory = nullptr);
+
+} // namespace CompileCommands
+
+#endif // COMPILE_COMMANDS_H
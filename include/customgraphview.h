@@ -8,6 +8,11 @@
 #include <QMap>
 #include <QJsonObject>
 #include <string>
+#include <string_view>
+
+namespace GraphGenerator {
+    class CFGGraph;
+}
 
 // Define the LayoutAlgorithm enum
 enum class LayoutAlgorithm {
@@ -40,7 +45,11 @@ public:
     void paintEvent(QPaintEvent* event);
     
     // Visualization features
+    // Builds the scene straight from the CFG, without going through DOT text
+    void displayCFG(const GraphGenerator::CFGGraph& graph);
     bool parseDotFormat(const QString& dotContent);
+    // Parses in place; pass a mapped file to avoid copying large inputs
+    bool parseDotFormat(std::string_view dotContent);
     void highlightFunction(const QString& functionName);
     void addFunctionCallHierarchy(const QJsonObject& functionCalls);
     void parsePlainFormat(const QString& plainOutput);
@@ -52,6 +61,11 @@ public:
     void setEdgeLabelsVisible(bool visible);
     void setLayoutAlgorithm(LayoutAlgorithm algorithm);
 
+    // Node labels longer than this are cut short; the full text shows when hovering the
+    // node. 0 (the default) shows labels in full.
+    void setMaxLabelLength(int length);
+    int maxLabelLength() const { return m_maxLabelLength; }
+
     QMap<QString, QString> parseAttributes(const QString& attrStr);
     QGraphicsItem* findNodeById(int id);
 
@@ -86,6 +100,10 @@ private:
     QPoint m_panStart;
     bool m_initialized = false;
     QTimer* m_initTimer;
+    int m_maxLabelLength = 0;
+    bool m_labelToolTipShown = false;
+
+    static const int FullLabelKey;  // item data holding the uncut label
 
     QMap<int, QGraphicsItem*> m_nodesMap;
     void parseAndCreateNode(int id, const QString& label, const QMap<QString, QString>& attributes);
@@ -96,7 +114,10 @@ private:
     void createNodeFromDot(int id, const QString& label, const QMap<QString, QString>& attributes);
     void createEdgeFromDot(int source, int target, const QMap<QString, QString>& attributes);
     QGraphicsTextItem* createNodeItem(const QString& label, bool isNewFile = false);
+    void setLabelText(QGraphicsTextItem* item, const QString& label);
+    QString fullLabelAt(const QPoint& pos) const;
     void layoutNodes();
+    void updateEdgePositions();  // after nodes moved
 };
 
 #endif // CUSTOMGRAPHVIEW_H
\ No newline at end of file
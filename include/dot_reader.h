@@ -0,0 +1,89 @@
+// dot_reader.h
+#ifndef DOT_READER_H
+#define DOT_READER_H
+
+#include <cstddef>
+#include <deque>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+// Streaming DOT parser: the input (a mapped file or any string) is tokenized in place
+// and statements are reported to a Handler as they are read, without per-line strings
+// or a syntax tree. Statements may span lines or share one; subgraphs, edge chains
+// (a -> b -> c) and subgraph operands (a -> {b c}) follow the DOT grammar.
+class DotReader {
+public:
+    struct Attribute {
+        std::string_view name;
+        std::string_view value;  // unquoted; label escapes such as \n are kept
+    };
+    using Attributes = std::vector<Attribute>;
+
+    enum class DefaultsKind { Graph, Node, Edge };
+
+    // Views passed to a handler are only valid during the call
+    class Handler {
+    public:
+        virtual ~Handler() = default;
+        // "graph|node|edge [...]", or "name = value" for the graph
+        virtual void defaults(DefaultsKind /*kind*/, const Attributes& /*attributes*/) {}
+        virtual void node(std::string_view /*id*/, const Attributes& /*attributes*/) {}
+        // Endpoints that have no node statement of their own are not reported as nodes
+        virtual void edge(std::string_view /*from*/, std::string_view /*to*/,
+                          const Attributes& /*attributes*/) {}
+    };
+
+    // Reads every graph in input. Returns false on a syntax error, after everything
+    // before it has been reported; error() then says where.
+    bool parse(std::string_view input, Handler& handler);
+    const std::string& error() const { return m_error; }
+
+    // Value of the named attribute (the last one wins), empty if absent
+    static std::string_view find(const Attributes& attributes, std::string_view name);
+    // Label text with \n, \l and \r line breaks and \\ resolved
+    static std::string unescapeLabel(std::string_view label);
+    // Whole-string decimal integer, for numeric node IDs
+    static bool toInt(std::string_view id, int& value);
+
+private:
+    enum class Token { End, ID, LeftBrace, RightBrace, LeftBracket, RightBracket,
+                       Semicolon, Comma, Equals, Colon, EdgeOp, Error };
+
+    Token next();
+    Token peek();
+    Token scan(std::string_view& text, bool& quoted);
+    void skipSpaceAndComments();
+    Token scanQuoted(std::string_view& text);
+    Token scanHtml(std::string_view& text);
+    bool isKeyword(const char* keyword) const;
+    void releaseScratch();
+
+    bool parseStatementList(Handler& handler);
+    bool parseStatement(Handler& handler);
+    bool parseOperand(Token token, Handler& handler, size_t& begin);
+    bool parseAttributeList(Attributes& attributes);
+    bool fail(const char* message);
+
+    std::string_view m_input;
+    size_t m_pos = 0;
+    size_t m_tokenStart = 0;
+
+    // Last token taken by next(), and the one seen by peek()
+    std::string_view m_text;
+    bool m_quoted = false;
+    Token m_peeked = Token::End;
+    std::string_view m_peekedText;
+    bool m_peekedQuoted = false;
+    bool m_hasPeeked = false;
+
+    size_t m_depth = 0;
+    std::vector<Attributes> m_attributeLists;            // one per nesting depth, reused
+    std::vector<std::string_view> m_members;             // node IDs of the current statement
+    std::vector<std::pair<size_t, size_t>> m_operands;   // ranges of m_members in edge chains
+    std::deque<std::string> m_scratch;                   // IDs that needed unescaping
+    std::string m_error;
+};
+
+#endif // DOT_READER_H
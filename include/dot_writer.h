@@ -0,0 +1,51 @@
+// dot_writer.h
+#ifndef DOT_WRITER_H
+#define DOT_WRITER_H
+
+#include <cstddef>
+#include <ostream>
+#include <string>
+#include <string_view>
+
+// Appends DOT text to one pre-sized buffer; the single emitter behind every DOT output.
+// String output grows the caller's string in place, stream output is written in large
+// blocks. Quoted text is escaped in one pass.
+class DotWriter {
+public:
+    explicit DotWriter(std::string& out);
+    // Flushed by flush() and on destruction
+    explicit DotWriter(std::ostream& out);
+    ~DotWriter();
+
+    DotWriter(const DotWriter&) = delete;
+    DotWriter& operator=(const DotWriter&) = delete;
+
+    // Room for about this many bytes of output
+    void reserve(size_t bytes);
+    // Typical size of a graph's DOT text, for reserve()
+    static size_t estimateSize(size_t nodeCount, size_t edgeCount);
+
+    // "digraph <name> {\n"; the name is quoted unless it is a plain identifier
+    DotWriter& beginGraph(std::string_view name);
+    DotWriter& endGraph() { return raw("}\n"); }
+
+    // "  <from> -> <to>", attributes and ";\n" are up to the caller
+    DotWriter& edge(long long from, long long to);
+
+    DotWriter& raw(std::string_view text);
+    DotWriter& raw(char c);
+    DotWriter& number(long long value);
+    // Contents of a quoted string: quotes and backslashes escaped, newlines as \n
+    DotWriter& escaped(std::string_view text);
+    DotWriter& quoted(std::string_view text) { raw('"'); escaped(text); return raw('"'); }
+
+    // False if the stream has failed
+    bool flush();
+
+private:
+    std::string* m_string = nullptr;
+    std::ostream* m_stream = nullptr;
+    std::string m_buffer;
+};
+
+#endif // DOT_WRITER_H
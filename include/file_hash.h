@@ -0,0 +1,22 @@
+// file_hash.h
+#ifndef FILE_HASH_H
+#define FILE_HASH_H
+
+#include <cstdint>
+#include <string>
+
+// Helpers shared by the on-disk caches and the analysis session
+namespace file_hash {
+
+    // Lower-case hex spelling of a hash, used in cache file names and manifests
+    std::string toHex(uint64_t value);
+
+    // xxHash64 of a file's contents; false when the file cannot be read
+    bool hashFile(const std::string& path, uint64_t& hash);
+
+    // Per-process suffix for files written under a temporary name and renamed into place
+    std::string tempSuffix();
+
+} // namespace file_hash
+
+#endif // FILE_HASH_H
@@ -2,10 +2,19 @@
 #define GRAPH_GENERATOR_H
 
 #include "parser.h" 
+#include "graph_properties.h"
+#include "json_writer.h"
+#include "statement_pool.h"
+#include <atomic>
+#include <cstdint>
+#include <iterator>
+#include <mutex>
 #include <set>
+#include <string_view>
 #include <utility>
 #include <memory>
 #include <string>
+#include <unordered_map>
 #include <vector>
 #include <map>
 #include <clang/AST/Stmt.h>
@@ -21,10 +30,14 @@ namespace GraphGenerator {
 
     // Use the forward declaration for the function signatures
     std::unique_ptr<CFGGraph> generateCFG(const std::vector<std::string>& sourceFiles);
-    std::unique_ptr<CFGGraph> generateCFG(const clang::FunctionDecl* FD);
+    // Statements are interned into the given pool, or a pool of the graph's own if null
+    std::unique_ptr<CFGGraph> generateCFG(const clang::FunctionDecl* FD,
+                                          std::shared_ptr<StatementPool> statements = nullptr);
     std::unique_ptr<CFGGraph> generateCustomCFG(const clang::FunctionDecl* FD);
     std::unique_ptr<CFGGraph> generateCFG(const Parser::FunctionInfo& functionInfo, clang::ASTContext* context);
     std::string getStmtString(const clang::Stmt* S);
+    // Text of S as written in its file, macro uses unexpanded; empty if there is none
+    llvm::StringRef getStmtSourceText(const clang::Stmt* S, const clang::ASTContext& context);
 
     // Typedef for Graph if needed
     using Graph = CFGGraph;
@@ -33,8 +46,8 @@ namespace GraphGenerator {
         int id;
         std::string label;
         std::string functionName;
-        std::set<int> successors;
-        std::vector<std::string> statements;
+        std::vector<StatementPool::Handle> statements;  // into the owning graph's pool
+        unsigned line = 0;                               // of the first statement, 0 if unknown
         
         // Default constructor
         CFGNode() : id(-1), label(""), functionName("") {}
@@ -51,15 +64,140 @@ namespace GraphGenerator {
         std::string label;
     };
 
+    // Nodes live in one array ordered by ID, and edges in CSR form: the successors of the
+    // node at index i are succTargets[succOffsets[i] .. succOffsets[i + 1]), sorted, with a
+    // flag byte per edge. Predecessors are stored the same way. addNode/addEdge and friends
+    // are a builder front end that collects into the same arrays; the CSR is (re)built on
+    // the first read after a change. Node IDs are looked up in a dense array while they are
+    // compact, as CFG block IDs are; negative or far-out IDs go to a hash map instead.
+    // This is the one CFG model: Parser, the serializers and the graph view read it through
+    // getNodes() and the accessors below instead of copying it into types of their own.
+    // Anything else known about a node or edge (metrics, layout, coverage, highlighting)
+    // goes into a typed property column parallel to the node or edge arrays.
     class CFGGraph {
     public:
+        enum NodeFlag : uint8_t {
+            TryBlockNode = 1 << 0,
+            ThrowingNode = 1 << 1
+        };
+
+        enum EdgeFlag : uint8_t {
+            ExceptionEdge = 1 << 0,
+            TrueBranch = 1 << 1,   // taken when a two-way terminator's condition holds
+            FalseBranch = 1 << 2
+        };
+
+        // Contiguous run of node IDs (successors or predecessors of one node)
+        class AdjacencyRange {
+        public:
+            AdjacencyRange() = default;
+            AdjacencyRange(const int* first, const int* last) : m_first(first), m_last(last) {}
+
+            const int* begin() const { return m_first; }
+            const int* end() const { return m_last; }
+            size_t size() const { return static_cast<size_t>(m_last - m_first); }
+            bool empty() const { return m_first == m_last; }
+
+        private:
+            const int* m_first = nullptr;
+            const int* m_last = nullptr;
+        };
+
+        // Statement texts of one node, resolved through the graph's pool
+        class StatementRange {
+        public:
+            class iterator {
+            public:
+                using value_type = std::string_view;
+                using difference_type = std::ptrdiff_t;
+                using iterator_category = std::forward_iterator_tag;
+
+                iterator(const StatementPool* pool, const StatementPool::Handle* handle)
+                    : m_pool(pool), m_handle(handle) {}
+
+                std::string_view operator*() const { return m_pool->get(*m_handle); }
+                iterator& operator++() { ++m_handle; return *this; }
+                bool operator==(const iterator& other) const { return m_handle == other.m_handle; }
+                bool operator!=(const iterator& other) const { return m_handle != other.m_handle; }
+
+            private:
+                const StatementPool* m_pool;
+                const StatementPool::Handle* m_handle;
+            };
+
+            StatementRange(const StatementPool* pool, const std::vector<StatementPool::Handle>& handles)
+                : m_pool(pool), m_handles(handles) {}
+
+            iterator begin() const { return iterator(m_pool, m_handles.data()); }
+            iterator end() const { return iterator(m_pool, m_handles.data() + m_handles.size()); }
+            size_t size() const { return m_handles.size(); }
+            bool empty() const { return m_handles.empty(); }
+            std::string_view operator[](size_t index) const { return m_pool->get(m_handles[index]); }
+
+        private:
+            const StatementPool* m_pool;
+            const std::vector<StatementPool::Handle>& m_handles;
+        };
+
+        // What getNodes() yields per node, shaped like the old map entries
+        struct NodeView {
+            int id;
+            const std::string& label;
+            const std::string& functionName;
+            unsigned line;
+            StatementRange statements;
+            AdjacencyRange successors;
+            AdjacencyRange predecessors;
+        };
+
+        class NodeRange {
+        public:
+            class iterator {
+            public:
+                using value_type = std::pair<int, NodeView>;
+                using difference_type = std::ptrdiff_t;
+                using iterator_category = std::forward_iterator_tag;
+
+                iterator(const CFGGraph* graph, size_t index) : m_graph(graph), m_index(index) {}
+
+                value_type operator*() const {
+                    NodeView view = m_graph->nodeView(m_index);
+                    return value_type(view.id, view);
+                }
+                iterator& operator++() { ++m_index; return *this; }
+                bool operator==(const iterator& other) const { return m_index == other.m_index; }
+                bool operator!=(const iterator& other) const { return m_index != other.m_index; }
+
+            private:
+                const CFGGraph* m_graph;
+                size_t m_index;
+            };
+
+            explicit NodeRange(const CFGGraph* graph) : m_graph(graph) {}
+
+            iterator begin() const { return iterator(m_graph, 0); }
+            iterator end() const { return iterator(m_graph, m_graph->getNodeCount()); }
+            size_t size() const { return m_graph->getNodeCount(); }
+            bool empty() const { return size() == 0; }
+
+        private:
+            const CFGGraph* m_graph;
+        };
+
+        // Copies share the statement pool, which only ever grows
+        explicit CFGGraph(std::shared_ptr<StatementPool> statements = nullptr);
+        CFGGraph(const CFGGraph& other);
+        CFGGraph& operator=(const CFGGraph& other);
+
         // Methods remain the same
         void writeToDotFile(const std::string& filename) const;
-        void writeToJsonFile(const std::string& filename, const json& astJson, const json& functionCallJson);
+        // Streamed straight to the file; compact unless a pretty style is asked for
+        void writeToJsonFile(const std::string& filename, const json& astJson, const json& functionCallJson,
+                             JsonWriter::Style style = JsonWriter::Style::Compact) const;
         std::string getNodeLabel(int nodeID) const;
 
         // New methods for exception handling
-        void addStatement(int nodeID, const std::string& stmt);
+        void addStatement(int nodeID, std::string_view stmt);
         void addExceptionEdge(int sourceID, int targetID);
         bool isExceptionEdge(int sourceID, int targetID) const;
         void markNodeAsTryBlock(int nodeID);
@@ -68,51 +206,127 @@ namespace GraphGenerator {
         bool isNodeThrowingException(int nodeID) const;
 
         void addNode(int id, const std::string& label);
+        void addNode(int nodeID);
+        void addStatementToNode(int nodeID, std::string_view stmt);
+        // Handle from this graph's statement pool
+        void addStatementHandle(int nodeID, StatementPool::Handle stmt);
+        void addEdge(int fromID, int toID, uint8_t flags = 0);
+        uint8_t getEdgeFlags(int sourceID, int targetID) const;
+        void setNodeLine(int nodeID, unsigned line);
+        unsigned getNodeLine(int nodeID) const;
+
+        // O(1)
         size_t getNodeCount() const;
         size_t getEdgeCount() const;
 
         // Get function names
-        std::vector<std::string> getFunctionNames() const {
-            std::vector<std::string> names;
-            for (const auto& pair : nodes) {
-                if (!pair.second.functionName.empty()) {
-                    names.push_back(pair.second.functionName);
-                }
-            }
-            return names;
-        }
-
-        // Existing methods remain the same
-        void addNode(int nodeID) {
-            if (nodes.find(nodeID) == nodes.end()) {
-                nodes[nodeID] = CFGNode(nodeID, "Block " + std::to_string(nodeID));
-            }
-        }
-        
-        void addStatementToNode(int nodeID, const std::string& stmt) {
-            if (nodes.find(nodeID) == nodes.end()) {
-                addNode(nodeID);
-            }
-            nodes[nodeID].statements.push_back(stmt);
-        }       
-        
-        void addEdge(int fromID, int toID) {
-            if (nodes.find(fromID) == nodes.end()) {
-                addNode(fromID);
-            }
-            nodes[fromID].successors.insert(toID);
-        }    
-        
-        const std::map<int, CFGNode>& getNodes() const noexcept { 
-            return nodes; 
-        }
-        
+        std::vector<std::string> getFunctionNames() const;
+
+        // Iterates (id, NodeView) pairs in ID order
+        NodeRange getNodes() const { return NodeRange(this); }
+
+        bool hasNode(int nodeID) const;
+        AdjacencyRange successors(int nodeID) const;
+        AdjacencyRange predecessors(int nodeID) const;
+
+        // Index-based access for traversals; indices follow ID order, -1 if absent
+        int indexOf(int nodeID) const;
+        NodeView nodeView(size_t index) const;
+
+        // Builds the CSR arrays now instead of on the first read
+        void finalize() const;
+
+        // xxHash64 of everything the graph shows: nodes, statements, flags and edges, but
+        // not property columns. Equal graphs hash equal in any process and on any run.
+        uint64_t contentHash() const;
+
+        const std::shared_ptr<StatementPool>& statementPool() const { return m_statements; }
+
+        // Index of the edge in edge property columns, -1 if there is no such edge. The
+        // edges of the node at index i are [edgeOffset(i), edgeOffset(i + 1)), in the
+        // order of nodeView(i).successors.
+        int edgeIndex(int sourceID, int targetID) const;
+        size_t edgeOffset(size_t index) const;
+
+        // Typed attribute columns, registered by name: node columns are indexed like
+        // nodeView(), edge columns like edgeIndex(). Registering a name again returns the
+        // existing column; a different type throws. Columns grow and are reordered along
+        // with the graph, so an index read before a change may name another node after it.
+        template <typename T>
+        PropertyColumn<T>& nodeProperty(const std::string& name, T defaultValue = T());
+        template <typename T>
+        PropertyColumn<T>& edgeProperty(const std::string& name, T defaultValue = T());
+        // nullptr if absent or of another type
+        template <typename T>
+        const PropertyColumn<T>* findNodeProperty(const std::string& name) const;
+        template <typename T>
+        const PropertyColumn<T>* findEdgeProperty(const std::string& name) const;
+        bool removeNodeProperty(const std::string& name);
+        bool removeEdgeProperty(const std::string& name);
+
+        const PropertyTable& nodeProperties() const { finalize(); return m_nodeProperties; }
+        const PropertyTable& edgeProperties() const { finalize(); return m_edgeProperties; }
+
     private:
-        std::map<int, CFGNode> nodes;
-        std::set<std::pair<int, int>> exceptionEdges;
-        std::set<int> tryBlocks;
-        std::set<int> throwingBlocks;
+        void ensureNode(int nodeID);
+        int lookupIndex(int nodeID) const;  // -1 if absent
+        void setIndex(int nodeID, int index) const;
+        void invalidate();
+        void buildAdjacency() const;
+        bool hasEdgeFlag(int sourceID, int targetID, uint8_t flag) const;
+
+        std::shared_ptr<StatementPool> m_statements;
+
+        // Node storage, in ID order once finalized
+        mutable std::vector<CFGNode> m_nodes;
+        mutable std::vector<uint8_t> m_nodeFlags;
+        mutable std::vector<int> m_indexById;  // dense, -1 for unused IDs
+        mutable std::unordered_map<int, int> m_sparseIndex;  // IDs outside the dense range
+
+        // Builder input, folded into the CSR arrays by buildAdjacency()
+        mutable std::vector<std::pair<int, int>> m_pendingEdges;
+        mutable std::vector<std::pair<std::pair<int, int>, uint8_t>> m_pendingEdgeFlags;
+
+        // CSR adjacency
+        mutable std::vector<uint32_t> m_succOffsets;
+        mutable std::vector<int> m_succTargets;
+        mutable std::vector<uint8_t> m_edgeFlags;
+        mutable std::vector<uint32_t> m_predOffsets;
+        mutable std::vector<int> m_predSources;
+        // Exception edges with no matching successor edge, sorted
+        mutable std::vector<std::pair<int, int>> m_extraExceptionEdges;
+
+        // Parallel to m_nodes and m_succTargets
+        mutable PropertyTable m_nodeProperties;
+        mutable PropertyTable m_edgeProperties;
+
+        mutable std::atomic<bool> m_finalized{false};
+        mutable std::mutex m_finalizeMutex;
     };
+
+    template <typename T>
+    PropertyColumn<T>& CFGGraph::nodeProperty(const std::string& name, T defaultValue) {
+        finalize();
+        return m_nodeProperties.add<T>(name, m_nodes.size(), std::move(defaultValue));
+    }
+
+    template <typename T>
+    PropertyColumn<T>& CFGGraph::edgeProperty(const std::string& name, T defaultValue) {
+        finalize();
+        return m_edgeProperties.add<T>(name, m_succTargets.size(), std::move(defaultValue));
+    }
+
+    template <typename T>
+    const PropertyColumn<T>* CFGGraph::findNodeProperty(const std::string& name) const {
+        finalize();
+        return m_nodeProperties.find<T>(name);
+    }
+
+    template <typename T>
+    const PropertyColumn<T>* CFGGraph::findEdgeProperty(const std::string& name) const {
+        finalize();
+        return m_edgeProperties.find<T>(name);
+    }
 }
 
 #endif // GRAPH_GENERATOR_H
\ No newline at end of file
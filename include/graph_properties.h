@@ -0,0 +1,145 @@
+// graph_properties.h
+#ifndef GRAPH_PROPERTIES_H
+#define GRAPH_PROPERTIES_H
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <typeinfo>
+#include <utility>
+#include <vector>
+
+namespace GraphGenerator {
+
+    // One attribute for every node (or edge) of a graph, as a dense array indexed like
+    // the graph's own node (or edge) storage
+    class PropertyColumnBase {
+    public:
+        virtual ~PropertyColumnBase() = default;
+
+        virtual const std::type_info& type() const = 0;
+        virtual size_t size() const = 0;
+        virtual void resize(size_t size) = 0;
+        // new[i] = old[order[i]]; positions past the old size get the default value
+        virtual void permute(const std::vector<uint32_t>& order) = 0;
+        virtual std::unique_ptr<PropertyColumnBase> clone() const = 0;
+    };
+
+    template <typename T>
+    class PropertyColumn : public PropertyColumnBase {
+    public:
+        explicit PropertyColumn(T defaultValue = T()) : m_default(std::move(defaultValue)) {}
+
+        const std::type_info& type() const override { return typeid(T); }
+        size_t size() const override { return m_values.size(); }
+        void resize(size_t size) override { m_values.resize(size, m_default); }
+
+        void permute(const std::vector<uint32_t>& order) override {
+            std::vector<T> values;
+            values.reserve(order.size());
+            for (uint32_t index : order) {
+                if (index < m_values.size()) {
+                    values.push_back(std::move(m_values[index]));
+                } else {
+                    values.push_back(m_default);
+                }
+            }
+            m_values.swap(values);
+        }
+
+        std::unique_ptr<PropertyColumnBase> clone() const override {
+            return std::make_unique<PropertyColumn<T>>(*this);
+        }
+
+        typename std::vector<T>::reference operator[](size_t index) { return m_values[index]; }
+        typename std::vector<T>::const_reference operator[](size_t index) const { return m_values[index]; }
+
+        // For scanning; the array is replaced when the graph changes shape
+        const std::vector<T>& values() const { return m_values; }
+        const T& defaultValue() const { return m_default; }
+
+        void fill(const T& value) { m_values.assign(m_values.size(), value); }
+
+    private:
+        std::vector<T> m_values;
+        T m_default;
+    };
+
+    // Named columns of one kind (node or edge) of a graph, all kept the same length
+    class PropertyTable {
+    public:
+        PropertyTable() = default;
+        PropertyTable(const PropertyTable& other) { *this = other; }
+        PropertyTable& operator=(const PropertyTable& other) {
+            if (this == &other) return *this;
+            m_columns.clear();
+            for (const auto& [name, column] : other.m_columns) {
+                m_columns.emplace(name, column->clone());
+            }
+            return *this;
+        }
+
+        // The existing column if the name is taken by the same type; throws if by another
+        template <typename T>
+        PropertyColumn<T>& add(const std::string& name, size_t size, T defaultValue) {
+            auto it = m_columns.find(name);
+            if (it == m_columns.end()) {
+                auto column = std::make_unique<PropertyColumn<T>>(std::move(defaultValue));
+                column->resize(size);
+                it = m_columns.emplace(name, std::move(column)).first;
+            } else if (it->second->type() != typeid(T)) {
+                throw std::invalid_argument("Property '" + name + "' already has another type");
+            }
+            return static_cast<PropertyColumn<T>&>(*it->second);
+        }
+
+        // nullptr if there is no such column or it holds another type
+        template <typename T>
+        PropertyColumn<T>* find(const std::string& name) {
+            auto it = m_columns.find(name);
+            if (it == m_columns.end() || it->second->type() != typeid(T)) return nullptr;
+            return static_cast<PropertyColumn<T>*>(it->second.get());
+        }
+
+        template <typename T>
+        const PropertyColumn<T>* find(const std::string& name) const {
+            return const_cast<PropertyTable*>(this)->find<T>(name);
+        }
+
+        // Untyped access, e.g. for serializers walking every column
+        const PropertyColumnBase* column(const std::string& name) const {
+            auto it = m_columns.find(name);
+            return it != m_columns.end() ? it->second.get() : nullptr;
+        }
+
+        bool remove(const std::string& name) { return m_columns.erase(name) > 0; }
+
+        // In name order
+        std::vector<std::string> names() const {
+            std::vector<std::string> result;
+            result.reserve(m_columns.size());
+            for (const auto& entry : m_columns) {
+                result.push_back(entry.first);
+            }
+            return result;
+        }
+
+        bool empty() const { return m_columns.empty(); }
+
+        void resize(size_t size) {
+            for (auto& entry : m_columns) entry.second->resize(size);
+        }
+
+        void permute(const std::vector<uint32_t>& order) {
+            for (auto& entry : m_columns) entry.second->permute(order);
+        }
+
+    private:
+        std::map<std::string, std::unique_ptr<PropertyColumnBase>> m_columns;
+    };
+
+} // namespace GraphGenerator
+
+#endif // GRAPH_PROPERTIES_H
@@ -5,16 +5,15 @@
 #include <QPainter>
 #include <QColor>
 #include <QString>
-#include <memory>
+#include "node.h"
 
 // Forward declarations to minimize includes
-class CFGNode;
 class QGraphicsSceneMouseEvent;
 
 class GraphicalCFGNode : public QGraphicsItem {
 public:
-    // Constructor for CFG node
-    explicit GraphicalCFGNode(const std::shared_ptr<CFGNode>& cfgNode, QGraphicsItem* parent = nullptr);
+    // Constructor for CFG node; the graph must outlive the item
+    GraphicalCFGNode(const CFGNodeGraph& graph, CFGNode::Handle node, QGraphicsItem* parent = nullptr);
 
     // Constructor for general graphical node
     GraphicalCFGNode(const QString& id, const QString& label, bool isNewFile, QGraphicsItem* parent = nullptr);
@@ -30,14 +29,16 @@ public:
     bool isNewFile() const;
 
     // Optional: get underlying CFG node if applicable
-    std::shared_ptr<CFGNode> getCFGNode() const { return m_cfgNode; }
+    CFGNode::Handle getCFGNode() const { return m_node; }
+    const CFGNodeGraph* getGraph() const { return m_graph; }
 
 protected:
     void mousePressEvent(QGraphicsSceneMouseEvent* event) override;
     void mouseReleaseEvent(QGraphicsSceneMouseEvent* event) override;
 
 private:
-    std::shared_ptr<CFGNode> m_cfgNode;
+    const CFGNodeGraph* m_graph = nullptr;
+    CFGNode::Handle m_node = CFGNode::InvalidHandle;
     QColor m_color;
     QString m_id;
     QString m_label;
@@ -0,0 +1,64 @@
+// incremental_analyzer.h
+#ifndef INCREMENTAL_ANALYZER_H
+#define INCREMENTAL_ANALYZER_H
+
+#include "analysis_session.h"
+#include <clang/Tooling/CompilationDatabase.h>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace GraphGenerator {
+    class CFGGraph;
+}
+
+namespace CFGAnalyzer {
+
+    // Remembers the body hash of every function seen per file. On each update only the
+    // functions whose hash changed (or that are new) get their CFG rebuilt and their
+    // <output>/<name>_cfg.dot rewritten; the file of a function that is gone is removed.
+    class IncrementalAnalyzer {
+    public:
+        struct ChangedFunction {
+            std::string name;  // qualified
+            std::shared_ptr<GraphGenerator::CFGGraph> graph;
+        };
+
+        // Keyed by USR, so overloads that change together are all reported
+        struct Update {
+            std::string filename;
+            bool success = false;
+            std::unordered_map<std::string, ChangedFunction> changed;
+            std::unordered_map<std::string, std::string> removed;  // USR -> qualified name
+            size_t unchanged = 0;
+        };
+
+        explicit IncrementalAnalyzer(const std::string& outputDir = "cfg_output");
+
+        // Diffs the functions of an already open session against the last update of its file
+        Update update(AnalysisSession& session);
+
+        // Same, parsing the file in a temporary session
+        Update update(const std::string& filename,
+                      std::shared_ptr<const clang::tooling::CompilationDatabase> compilations);
+
+        // Drops the remembered hashes so the next update re-emits every function
+        void forget(const std::string& filename);
+
+    private:
+        struct FunctionState {
+            std::string name;
+            uint64_t bodyHash;
+        };
+
+        std::string m_outputDir;
+        std::mutex m_mutex;
+        std::unordered_map<std::string, std::unordered_map<std::string, FunctionState>> m_functions;  // file -> USR -> state
+    };
+
+} // namespace CFGAnalyzer
+
+#endif // INCREMENTAL_ANALYZER_H
@@ -0,0 +1,86 @@
+// json_writer.h
+#ifndef JSON_WRITER_H
+#define JSON_WRITER_H
+
+#include <nlohmann/json_fwd.hpp>
+#include <cstddef>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+// Streaming JSON emitter: values go out as they are written, with no document tree in
+// between. Compact by default; Pretty matches nlohmann::json::dump(indent). Stream output
+// is buffered and written in large blocks. Misuse (a value where a key is expected, say)
+// is not checked; callers write well-formed sequences.
+class JsonWriter {
+public:
+    enum class Style { Compact, Pretty };
+
+    // Appends to out
+    explicit JsonWriter(std::string& out, Style style = Style::Compact, int indent = 2);
+    // Writes to out; flushed by flush() and on destruction
+    explicit JsonWriter(std::ostream& out, Style style = Style::Compact, int indent = 2);
+    ~JsonWriter();
+
+    JsonWriter(const JsonWriter&) = delete;
+    JsonWriter& operator=(const JsonWriter&) = delete;
+
+    JsonWriter& beginObject();
+    JsonWriter& endObject();
+    JsonWriter& beginArray();
+    JsonWriter& endArray();
+    JsonWriter& key(std::string_view name);
+
+    JsonWriter& value(std::string_view text);
+    JsonWriter& value(const char* text) { return value(std::string_view(text)); }
+    JsonWriter& value(const std::string& text) { return value(std::string_view(text)); }
+    JsonWriter& value(bool flag);
+    JsonWriter& value(double number);
+    JsonWriter& value(const nlohmann::json& tree);
+    JsonWriter& null();
+
+    template <typename T, typename std::enable_if<std::is_integral<T>::value &&
+                                                  !std::is_same<T, bool>::value, int>::type = 0>
+    JsonWriter& value(T number) {
+        return std::is_signed<T>::value ? integer(static_cast<long long>(number))
+                                        : unsignedInteger(static_cast<unsigned long long>(number));
+    }
+
+    // key(name) followed by value(v)
+    template <typename T>
+    JsonWriter& member(std::string_view name, const T& v) {
+        key(name);
+        return value(v);
+    }
+
+    // False if the stream has failed
+    bool flush();
+
+private:
+    struct Level {
+        bool object;
+        size_t count;
+    };
+
+    JsonWriter& integer(long long number);
+    JsonWriter& unsignedInteger(unsigned long long number);
+    JsonWriter& begin(bool object, char bracket);
+    JsonWriter& end(char bracket);
+    void beforeValue();
+    void newline(size_t depth);
+    void write(std::string_view text);
+    void write(char c);
+    void writeString(std::string_view text);
+
+    std::string* m_string = nullptr;
+    std::ostream* m_stream = nullptr;
+    std::string m_buffer;
+    Style m_style;
+    int m_indent;
+    std::vector<Level> m_levels;
+    bool m_afterKey = false;
+};
+
+#endif // JSON_WRITER_H
@@ -4,10 +4,16 @@
 #include <QMainWindow>
 #include <QSet>
 #include <QListWidgetItem>
+#include <QFileSystemWatcher>
+#include <QTimer>
 #include <QJsonObject>
 #include <QJsonArray>
 #include <QJsonDocument>
+#include "analysis_session.h"
 #include "cfg_analyzer.h"
+#include "cfg_binary.h"
+#include "cfg_bundle.h"
+#include "incremental_analyzer.h"
 #include "customgraphview.h"
 #include "graph_generator.h"
 #include "parser.h"
@@ -27,18 +33,21 @@ public:
     static const int EdgeItemType;
     static const QString NodeTypeKey;
     static const QString EdgeTypeKey;
+    static const int MaxNodeLabelLength;  // longer node labels are cut in the graph view
 
     explicit MainWindow(QWidget *parent = nullptr);
     ~MainWindow();
     
     void handleAnalysisResult(const CFGAnalyzer::AnalysisResult& result);
-    void loadAndProcessJson(const QString& filePath);
+    bool loadAndProcessJson(const QString& filePath);
+    void loadBinaryCFG(const QString& filePath);
+    void loadBundle(const QString& filePath);
     void initializeGraphviz();
     void safeInitialize();
     void startTextOnlyMode();
     bool tryInitializeView(bool tryHardware);
     bool testRendering();
-    void visualizeCFG(std::shared_ptr<GraphGenerator::CFGGraph> graph);
+    void visualizeCFG(std::shared_ptr<const GraphGenerator::CFGGraph> graph);
 
 
 public slots:
@@ -51,7 +60,13 @@ signals:
 private slots:
     void on_browseButton_clicked();
     void on_analyzeButton_clicked();
+    void on_loadCompileCommands_triggered();
+    void on_analyzeProject_triggered();
+    void on_watchFiles_toggled(bool enabled);
+    void onWatchedFileChanged(const QString& path);
+    void reanalyzeChangedFiles();
     void on_openFilesButton_clicked();
+    void on_analyzeAllButton_clicked();
     void on_searchButton_clicked();
     void on_toggleFunctionGraph_clicked();
     void on_fileList_itemClicked(QListWidgetItem *item);
@@ -84,10 +99,23 @@ private:
     CustomGraphView* m_graphView = nullptr;
     Parser m_parser;
     ASTExtractor m_astExtractor;
+    CFGAnalyzer::IncrementalAnalyzer m_incremental;
+    QFileSystemWatcher* m_watcher = nullptr;
+    QTimer* m_watchTimer = nullptr;
+    QSet<QString> m_changedFiles;
+    QSet<QString> m_updatingFiles;  // with an incremental update running
+    QString m_currentFunction;  // qualified name of the function CFG on display, if any
+    std::string m_currentUsr;   // and its USR, when it came from a session
+    std::shared_ptr<const clang::tooling::CompilationDatabase> m_compilations;  // loaded by the user
+    // Databases found next to analyzed files, by the path of their compile_commands.json
+    std::unordered_map<std::string, std::shared_ptr<const clang::tooling::CompilationDatabase>> m_discoveredCompilations;
+    std::shared_ptr<const clang::tooling::CompilationDatabase> compilationsFor(const QString& filePath);
     std::shared_ptr<GraphGenerator::CFGGraph> generateFunctionCFG(const QString& filePath, 
-        const QString& functionName);
+        const QString& functionName,
+        std::shared_ptr<const clang::tooling::CompilationDatabase> compilations,
+        QString* qualifiedName = nullptr, std::string* usr = nullptr);
     
-    std::shared_ptr<GraphGenerator::CFGGraph> parseDotToCFG(const QString& dotContent);
+    std::shared_ptr<GraphGenerator::CFGGraph> parseDotToCFG(std::string_view dotContent);
 
     enum LayoutAlgorithm {
         Hierarchical,
@@ -104,13 +132,18 @@ private:
     
     LayoutAlgorithm m_currentLayoutAlgorithm;
     Theme m_currentTheme;
-    std::shared_ptr<GraphGenerator::CFGGraph> m_currentGraph;
+    std::shared_ptr<const GraphGenerator::CFGGraph> m_currentGraph;
+    std::shared_ptr<const GraphGenerator::BinaryCFGFile> m_binaryCFGs;  // last .cfgb opened
+    std::shared_ptr<const GraphGenerator::BundleFile> m_bundle;          // last .cfgbundle opened
+    // Per-function CFGs of the last analysis, shared with the analyzer's result
+    std::unordered_map<std::string, std::shared_ptr<const GraphGenerator::CFGGraph>> m_analysisCFGs;
 
     void createNode();
     void createEdge();
     void applyGraphLayout();
     void setUiEnabled(bool enabled);
     void visualizeFunction(const QString& functionName);
+    void applyIncrementalUpdate(const CFGAnalyzer::IncrementalAnalyzer::Update& update);
     void applyGraphTheme();
     void setupGraphLayout();
     void highlightFunction(const QString& functionName);
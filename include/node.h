@@ -1,9 +1,12 @@
 #ifndef CFG_NODE_H
 #define CFG_NODE_H
 
+#include <cstddef>
+#include <cstdint>
+#include <limits>
 #include <string>
+#include <unordered_set>
 #include <vector>
-#include <memory>
 
 class CFGNode {
 public:
@@ -15,32 +18,75 @@ public:
         FUNCTION_CALL
     };
 
+    // Index of a node in its CFGNodeGraph; stays valid for the graph's lifetime
+    using Handle = uint32_t;
+    static constexpr Handle InvalidHandle = std::numeric_limits<Handle>::max();
+
     CFGNode(const std::string& content, NodeType type);
 
     // Node identification and content
-    std::string getContent() const;
+    const std::string& getContent() const;
     NodeType getType() const;
     std::string getTypeString() const;
 
-    // Control flow management
-    void addSuccessor(std::shared_ptr<CFGNode> node);
-    void addPredecessor(std::shared_ptr<CFGNode> node);
-
-    // Get successors and predecessors
-    std::vector<std::shared_ptr<CFGNode>> getSuccessors() const;
-    std::vector<std::shared_ptr<CFGNode>> getPredecessors() const;
-
     // Unique identifier
     std::string getUniqueId() const;
 
 private:
     std::string m_content;
     NodeType m_type;
-    std::vector<std::shared_ptr<CFGNode>> m_successors;
-    std::vector<std::shared_ptr<CFGNode>> m_predecessors;
-    std::string m_uniqueId;
+    size_t m_serial;
 
     static size_t s_nodeCounter;
 };
 
-#endif // CFG_NODE_H
\ No newline at end of file
+// Owns its nodes in one arena. Nodes are never removed, so a handle stays valid as long
+// as the graph does, and edges are plain indices rather than shared_ptr cycles.
+class CFGNodeGraph {
+public:
+    using Handle = CFGNode::Handle;
+
+    // Non-copying view of a node's successors or predecessors
+    class HandleRange {
+    public:
+        HandleRange(const Handle* first, const Handle* last) : m_first(first), m_last(last) {}
+        const Handle* begin() const { return m_first; }
+        const Handle* end() const { return m_last; }
+        size_t size() const { return static_cast<size_t>(m_last - m_first); }
+        bool empty() const { return m_first == m_last; }
+        Handle operator[](size_t i) const { return m_first[i]; }
+
+    private:
+        const Handle* m_first;
+        const Handle* m_last;
+    };
+
+    Handle addNode(const std::string& content, CFGNode::NodeType type);
+
+    // Records from -> to once; duplicates are ignored. Returns false for invalid handles.
+    bool addEdge(Handle from, Handle to);
+
+    bool contains(Handle node) const { return node < m_nodes.size(); }
+    const CFGNode& node(Handle node) const { return m_nodes[node]; }
+
+    HandleRange successors(Handle node) const;
+    HandleRange predecessors(Handle node) const;
+
+    size_t nodeCount() const { return m_nodes.size(); }
+    size_t edgeCount() const { return m_edges.size(); }
+
+    void reserve(size_t nodes);
+    void clear();
+
+private:
+    static uint64_t edgeKey(Handle from, Handle to) {
+        return (static_cast<uint64_t>(from) << 32) | to;
+    }
+
+    std::vector<CFGNode> m_nodes;
+    std::vector<std::vector<Handle>> m_successors;
+    std::vector<std::vector<Handle>> m_predecessors;
+    std::unordered_set<uint64_t> m_edges;
+};
+
+#endif // CFG_NODE_H
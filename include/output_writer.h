@@ -0,0 +1,99 @@
+// output_writer.h
+#ifndef OUTPUT_WRITER_H
+#define OUTPUT_WRITER_H
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+namespace GraphGenerator {
+    class CFGGraph;
+    class BundleWriter;
+}
+
+// Groups the jobs of one submitter (an analysis run), so it waits for and counts its own
+// writes only. Shared with the writer, which keeps it until the jobs are done.
+class OutputTicket {
+private:
+    friend class OutputWriter;
+    size_t m_pending = 0;   // guarded by the writer's mutex
+    size_t m_failures = 0;
+};
+
+// Process-wide background writer for analysis artifacts, so AST traversal never waits on
+// the file system. Jobs go into a bounded queue (submitting blocks while it is full) and
+// are taken in batches. Each file is rendered into one buffer, written to "<path>.<n>.tmp"
+// in a single write and renamed over <path>: a reader sees the old file, the complete
+// new one, or none, never a partial one.
+// Bundles belong to whoever opened them; the writer only adds the entries it is given.
+class OutputWriter {
+public:
+    static OutputWriter& instance();
+
+    // Called on the writer thread once a job is done, with whether it succeeded
+    using DoneCallback = std::function<void(bool written)>;
+
+    // The graph's DOT text, rendered on the writer thread. The graph is only read.
+    void submitDot(const std::string& path, std::shared_ptr<const GraphGenerator::CFGGraph> graph,
+                   std::shared_ptr<OutputTicket> ticket = nullptr, DoneCallback done = nullptr);
+    void submit(const std::string& path, std::string content,
+                std::shared_ptr<OutputTicket> ticket = nullptr);
+    // Deletes path, after anything submitted for it before
+    void submitRemoval(const std::string& path, std::shared_ptr<OutputTicket> ticket = nullptr);
+    // A function's DOT text, as an entry of bundle keyed by name and USR. The bundle may
+    // only be finished after a flush() of the jobs that add to it.
+    void submitFunction(std::shared_ptr<GraphGenerator::BundleWriter> bundle,
+                        const std::string& name, const std::string& usr,
+                        std::shared_ptr<const GraphGenerator::CFGGraph> graph,
+                        std::shared_ptr<OutputTicket> ticket = nullptr);
+
+    // Blocks until the ticket's jobs are on disk or in their bundle; returns how many of
+    // them failed since the previous flush of the ticket. Without a ticket, waits for the
+    // whole queue and counts the jobs submitted without one.
+    size_t flush(const std::shared_ptr<OutputTicket>& ticket = nullptr);
+
+    // Queued jobs before submit() blocks
+    void setQueueCapacity(size_t jobs);
+
+    OutputWriter(const OutputWriter&) = delete;
+    OutputWriter& operator=(const OutputWriter&) = delete;
+
+private:
+    OutputWriter() = default;
+    ~OutputWriter();
+
+    struct Job {
+        std::string path;
+        std::shared_ptr<const GraphGenerator::CFGGraph> graph;  // rendered as DOT if set
+        std::string content;
+        bool remove = false;                                     // delete path instead
+        std::shared_ptr<GraphGenerator::BundleWriter> bundle{};  // written there if set
+        std::string name{};
+        std::string usr{};
+        std::shared_ptr<OutputTicket> ticket{};
+        DoneCallback done{};
+        bool failed = false;
+    };
+
+    void enqueue(Job job);
+    void run();
+    static bool writeFile(const std::string& path, const std::string& content);
+
+    std::mutex m_mutex;
+    std::condition_variable m_hasWork;
+    std::condition_variable m_hasRoom;
+    std::condition_variable m_drained;
+    std::deque<Job> m_queue;
+    size_t m_capacity = 256;
+    size_t m_writing = 0;   // jobs taken by the writer and not yet finished
+    size_t m_failures = 0;  // of jobs without a ticket
+    bool m_stopping = false;
+    std::thread m_thread;   // started by the first submit
+};
+
+#endif // OUTPUT_WRITER_H
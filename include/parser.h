@@ -5,13 +5,19 @@
 #include <clang/AST/ASTContext.h>
 #include <clang/Basic/Diagnostic.h>
 #include <clang/AST/ASTConsumer.h>
+#include <clang/Tooling/CompilationDatabase.h>
 #include <memory>
 #include <vector>
 #include <string>
 #include <map>
 
+namespace GraphGenerator {
+    class CFGGraph;
+}
+
 namespace clang {
     class CompilerInstance;
+    class FrontendAction;
     class ASTConsumer;
     class FunctionDecl;
     class CFG;
@@ -22,23 +28,10 @@ public:
     // Forward declare ASTStoringConsumer first
     class ASTStoringConsumer;
     
-    struct CFGNode {
-        unsigned id;
-        std::string label;
-        unsigned line;
-        std::string code;
-    };
-
-    struct CFGEdge {
-        unsigned sourceId;
-        unsigned targetId;
-        std::string label;
-    };
-
+    // A function's CFG in the shared GraphGenerator::CFGGraph model
     struct FunctionCFG {
         std::string functionName;
-        std::vector<CFGNode> nodes;
-        std::vector<CFGEdge> edges;
+        std::shared_ptr<const GraphGenerator::CFGGraph> graph;
     };
 
     struct FunctionInfo {
@@ -48,28 +41,53 @@ public:
         bool hasBody;
     };
 
-    // Single definition of ThreadLocalState
+    // Single definition of ThreadLocalState. One per thread (or batch worker): the
+    // CompilerInstance and its FileManager are reused for every file parsed on it.
     struct ThreadLocalState {
         ~ThreadLocalState();
-        clang::ASTContext* parse(const std::string& filePath);
+        clang::ASTContext* parse(const std::string& filePath,
+                                 const clang::tooling::CompilationDatabase* compilations = nullptr);
+        // Runs any frontend action on the file; keepAST leaves the ASTContext alive afterwards
+        bool execute(const std::string& filePath,
+                     const clang::tooling::CompilationDatabase* compilations,
+                     clang::FrontendAction& action,
+                     bool keepAST = false);
         void setupCompiler();
         
         std::unique_ptr<clang::CompilerInstance> compiler;
         std::unique_ptr<ASTStoringConsumer> consumer;
     };
 
+    // Unsaved editor contents, path -> text; paths are spelled as in the compile command
+    using UnsavedFiles = std::map<std::string, std::string>;
+
     Parser();
     ~Parser();
 
-    static std::unique_ptr<clang::ASTUnit> parseFileWithAST(const std::string& filename);
+    // Flags come from the compilation database when it has an entry for the file
+    void setCompilationDatabase(std::shared_ptr<const clang::tooling::CompilationDatabase> compilations);
+
+    static std::unique_ptr<clang::ASTUnit> parseFileWithAST(const std::string& filename,
+        const clang::tooling::CompilationDatabase* compilations = nullptr);
     static bool isDotFile(const std::string& filePath);
+
+    // Parses the file with the unsaved buffers mapped over what is on disk. The ASTUnit
+    // stays alive in this Parser and later calls for the same file only Reparse it, which
+    // keeps its precompiled preamble. The unit is valid until the next call; nullptr on failure.
+    clang::ASTUnit* parseUnsaved(const std::string& filename, const UnsavedFiles& unsavedFiles);
+    void releaseUnsaved();
+
     std::vector<FunctionInfo> extractFunctions(const std::string& filePath);
     std::vector<FunctionCFG> extractAllCFGs(const std::string& filePath);
     std::string generateDOT(const FunctionCFG& cfg);
 
 private:
     struct FunctionVisitor;
-    static clang::ASTContext* parseFile(const std::string& filename);
+    struct LiveUnit;
+    clang::ASTContext* parseFile(const std::string& filename);
+
+    std::shared_ptr<const clang::tooling::CompilationDatabase> m_compilations;
+    std::unique_ptr<LiveUnit> m_live;
 };
 
 // Define ASTStoringConsumer after Parser class definition
@@ -0,0 +1,66 @@
+// preamble_cache.h
+#ifndef PREAMBLE_CACHE_H
+#define PREAMBLE_CACHE_H
+
+#include <clang/Tooling/ArgumentsAdjusters.h>
+#include <clang/Tooling/CompilationDatabase.h>
+#include <cstdint>
+#include <ctime>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Process-wide cache of implicit PCHs for the leading block of system includes
+// (<iostream>, <vector>, ...) of a source file. Files with the same flags and the
+// same leading includes share one PCH, which is rebuilt only when one of the
+// headers that went into it changes on disk.
+class PreambleCache {
+public:
+    static PreambleCache& instance();
+
+    void setEnabled(bool enabled);
+    bool isEnabled() const;
+
+    // Defaults to <system temp>/cfgparser-preambles
+    void setCacheDirectory(const std::string& directory);
+    std::string cacheDirectory() const;
+
+    // Driver command line with -include-pch added when a preamble applies to mainFile.
+    // Returns the command line unchanged if the file has no leading includes or the
+    // PCH cannot be built.
+    std::vector<std::string> adjustCommandLine(const std::vector<std::string>& commandLine,
+                                               const std::string& mainFile,
+                                               const std::string& workingDirectory);
+
+    // Same as adjustCommandLine, for ClangTool. The database (if any) must outlive the tool.
+    clang::tooling::ArgumentsAdjuster adjuster(const clang::tooling::CompilationDatabase* compilations);
+
+    // Leading run of #include <...> lines of a file, comments and blank lines skipped
+    static std::string leadingIncludes(const std::string& mainFile);
+
+private:
+    PreambleCache();
+
+    struct InputStamp {
+        std::string path;
+        std::time_t modificationTime;
+        uint64_t size;
+    };
+
+    bool isUpToDate(const std::string& pchPath, const std::string& depsPath) const;
+    bool build(const std::vector<std::string>& commandLine,
+               const std::string& mainFile,
+               const std::string& workingDirectory,
+               const std::string& preamble,
+               const std::string& basePath);
+    std::shared_ptr<std::mutex> lockFor(const std::string& key);
+
+    bool m_enabled;
+    std::string m_directory;
+    mutable std::mutex m_mutex;
+    std::map<std::string, std::shared_ptr<std::mutex>> m_buildLocks;
+};
+
+#endif // PREAMBLE_CACHE_H
@@ -0,0 +1,60 @@
+// statement_pool.h
+#ifndef STATEMENT_POOL_H
+#define STATEMENT_POOL_H
+
+#include <cstdint>
+#include <memory>
+#include <shared_mutex>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace GraphGenerator {
+
+    // Interning arena for statement text. Each distinct text is stored once in append-only
+    // chunks and named by a 32-bit handle, so CFG nodes hold handles instead of strings.
+    // Safe to share between threads. A pool lives as long as the graphs that reference it;
+    // analysis sessions start a fresh one when the current one is full, so memory follows
+    // the live graphs instead of everything ever analyzed.
+    class StatementPool {
+    public:
+        using Handle = uint32_t;
+
+        static constexpr size_t DefaultMaxBytes = 64 * 1024 * 1024;
+
+        StatementPool() = default;
+        StatementPool(const StatementPool&) = delete;
+        StatementPool& operator=(const StatementPool&) = delete;
+
+        Handle intern(std::string_view text);
+
+        // Valid while the pool is alive
+        std::string_view get(Handle handle) const;
+
+        size_t size() const;
+        size_t byteSize() const;
+
+        // Pool to intern into next: pool itself, or a new one if it is unset or has grown
+        // past maxBytes. Graphs already built keep the old pool alive.
+        static std::shared_ptr<StatementPool> acquire(std::shared_ptr<StatementPool>& pool,
+                                                      size_t maxBytes = DefaultMaxBytes);
+
+    private:
+        std::string_view store(std::string_view text);
+
+        static constexpr size_t MaxChunkSize = 64 * 1024;
+
+        mutable std::shared_mutex m_mutex;
+        std::vector<std::unique_ptr<char[]>> m_chunks;
+        std::vector<std::unique_ptr<char[]>> m_largeStrings;
+        size_t m_chunkCapacity = 0;
+        size_t m_chunkUsed = 0;
+        size_t m_nextChunkSize = 1024;
+        size_t m_bytes = 0;
+        std::vector<std::string_view> m_strings;
+        std::unordered_map<std::string_view, Handle> m_index;
+    };
+
+} // namespace GraphGenerator
+
+#endif // STATEMENT_POOL_H
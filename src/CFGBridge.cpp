@@ -1,5 +1,6 @@
 #include "CFGBridge.h"
 #include "cfg_analyzer.h"
+#include "dot_reader.h"
 #include <QTemporaryFile>
 #include <QFileInfo>
 #include <QDir>
@@ -105,7 +106,7 @@ void CFGBridge::onProcessFinished(int exitCode, QProcess::ExitStatus exitStatus)
         return;
     }
 
-    QString dotContent = QString::fromUtf8(dotFile.readAll());
+    QByteArray dotContent = dotFile.readAll();
     QString reportContent = QString::fromUtf8(reportFile.readAll());
 
     dotFile.close();
@@ -114,8 +115,30 @@ void CFGBridge::onProcessFinished(int exitCode, QProcess::ExitStatus exitStatus)
     QFile::remove(m_outputDotFile);
     QFile::remove(m_outputReportFile);
 
+    // The tool's call graph DOT is read once into the same graphs an in-process run has
+    class DependencyCollector : public DotReader::Handler {
+    public:
+        explicit DependencyCollector(std::unordered_map<std::string, std::set<std::string>>& dependencies)
+            : m_dependencies(dependencies) {}
+        void node(std::string_view id, const DotReader::Attributes&) override {
+            m_dependencies[std::string(id)];
+        }
+        void edge(std::string_view from, std::string_view to, const DotReader::Attributes&) override {
+            m_dependencies[std::string(from)].insert(std::string(to));
+        }
+    private:
+        std::unordered_map<std::string, std::set<std::string>>& m_dependencies;
+    };
+
     CFGAnalyzer::AnalysisResult result;
-    result.dotOutput = dotContent.toStdString();
+    DependencyCollector collector(result.functionDependencies);
+    DotReader reader;
+    if (!reader.parse(std::string_view(dotContent.constData(), static_cast<size_t>(dotContent.size())),
+                      collector)) {
+        qWarning() << "DOT parse error:" << QString::fromStdString(reader.error());
+    }
+    result.callGraph = CFGAnalyzer::buildCallGraph(result.functionDependencies);
+    result.contentHash = CFGAnalyzer::contentHash(result);
     result.report = reportContent.toStdString();
     result.success = true;
     emit analysisComplete(result);
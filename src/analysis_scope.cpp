@@ -0,0 +1,137 @@
+#include "analysis_scope.h"
+#include <clang/AST/DeclBase.h>
+#include <clang/Basic/SourceManager.h>
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/Path.h>
+#include <mutex>
+#include <QDebug>
+
+namespace {
+
+    std::mutex scopeMutex;
+
+    AnalysisScope& currentScope() {
+        static AnalysisScope scope;
+        return scope;
+    }
+
+    std::vector<llvm::GlobPattern> compileGlobs(const std::vector<std::string>& patterns) {
+        std::vector<llvm::GlobPattern> globs;
+        for (const std::string& pattern : patterns) {
+            auto glob = llvm::GlobPattern::create(pattern);
+            if (!glob) {
+                qWarning() << "Ignoring invalid glob" << pattern.c_str() << ":"
+                           << llvm::toString(glob.takeError()).c_str();
+                continue;
+            }
+            globs.push_back(std::move(*glob));
+        }
+        return globs;
+    }
+
+    // Absolute, with a trailing separator so "/src/foo" does not match "/src/foobar"
+    std::string directoryPrefix(llvm::StringRef directory) {
+        llvm::SmallString<256> path(directory);
+        llvm::sys::fs::make_absolute(path);
+        llvm::sys::path::remove_dots(path, true);
+        std::string prefix(path.str());
+        if (!prefix.empty() && !llvm::sys::path::is_separator(prefix.back())) {
+            prefix += llvm::sys::path::get_separator();
+        }
+        return prefix;
+    }
+
+} // namespace
+
+AnalysisScope AnalysisScope::current() {
+    std::lock_guard<std::mutex> lock(scopeMutex);
+    return currentScope();
+}
+
+void AnalysisScope::setCurrent(const AnalysisScope& scope) {
+    std::lock_guard<std::mutex> lock(scopeMutex);
+    currentScope() = scope;
+}
+
+AnalysisScope::Filter::Filter(const AnalysisScope& scope, const clang::SourceManager& SM)
+    : m_scope(scope),
+      m_sourceManager(SM),
+      m_includeGlobs(compileGlobs(scope.includeGlobs)),
+      m_excludeGlobs(compileGlobs(scope.excludeGlobs)) {
+    for (const std::string& directory : scope.projectDirectories) {
+        m_directories.push_back(directoryPrefix(directory));
+    }
+}
+
+bool AnalysisScope::Filter::contains(const clang::Decl* D) {
+    return D && contains(D->getLocation());
+}
+
+bool AnalysisScope::Filter::contains(clang::SourceLocation loc) {
+    if (loc.isInvalid()) return false;
+    clang::SourceLocation expansion = m_sourceManager.getExpansionLoc(loc);
+    return fileInScope(m_sourceManager.getFileID(expansion));
+}
+
+bool AnalysisScope::Filter::fileInScope(clang::FileID file) {
+    auto cached = m_files.find(file);
+    if (cached != m_files.end()) {
+        return cached->second;
+    }
+
+    bool inScope = [&]() {
+        if (file.isInvalid()) return false;
+
+        clang::SourceLocation start = m_sourceManager.getLocForStartOfFile(file);
+        if (!m_scope.includeSystemHeaders && m_sourceManager.isInSystemHeader(start)) {
+            return false;
+        }
+
+        bool isMainFile = file == m_sourceManager.getMainFileID();
+        if (m_scope.mode == Mode::MainFile && isMainFile &&
+            m_excludeGlobs.empty() && m_includeGlobs.empty()) {
+            return true;  // common case, no path needed
+        }
+
+        std::string path;
+        if (const clang::FileEntry* entry = m_sourceManager.getFileEntryForID(file)) {
+            path = entry->tryGetRealPathName().str();
+            if (path.empty()) path = entry->getName().str();
+        }
+        if (path.empty()) return false;
+
+        for (const auto& glob : m_excludeGlobs) {
+            if (glob.match(path)) return false;
+        }
+        for (const auto& glob : m_includeGlobs) {
+            if (glob.match(path)) return true;
+        }
+
+        switch (m_scope.mode) {
+        case Mode::MainFile:
+            return isMainFile;
+        case Mode::ProjectDirectories: {
+            if (isMainFile) return true;
+            if (m_directories.empty()) {
+                // Default project root: wherever the main file lives
+                if (const clang::FileEntry* mainEntry =
+                        m_sourceManager.getFileEntryForID(m_sourceManager.getMainFileID())) {
+                    std::string mainPath = mainEntry->tryGetRealPathName().str();
+                    if (mainPath.empty()) mainPath = mainEntry->getName().str();
+                    m_directories.push_back(directoryPrefix(llvm::sys::path::parent_path(mainPath)));
+                }
+            }
+            for (const std::string& directory : m_directories) {
+                if (llvm::StringRef(path).startswith(directory)) return true;
+            }
+            return false;
+        }
+        case Mode::AllFiles:
+            return true;
+        }
+        return false;
+    }();
+
+    m_files[file] = inScope;
+    return inScope;
+}
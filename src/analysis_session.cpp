@@ -0,0 +1,216 @@
+#include "analysis_session.h"
+#include "analysis_scope.h"
+#include "file_hash.h"
+#include "graph_generator.h"
+#include "parser.h"
+#include <clang/AST/RecursiveASTVisitor.h>
+#include <clang/Index/USRGeneration.h>
+#include <clang/Lex/Lexer.h>
+#include <llvm/ADT/SmallString.h>
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/xxhash.h>
+#include <algorithm>
+#include <cctype>
+#include <list>
+
+namespace {
+
+    std::string toLower(std::string text) {
+        std::transform(text.begin(), text.end(), text.begin(),
+                       [](unsigned char c) { return std::tolower(c); });
+        return text;
+    }
+
+    // Function definitions inside the analysis scope
+    class DefinitionCollector : public clang::RecursiveASTVisitor<DefinitionCollector> {
+    public:
+        explicit DefinitionCollector(const clang::SourceManager& SM)
+            : Scope(AnalysisScope::current(), SM) {}
+
+        bool TraverseDecl(clang::Decl* D) {
+            if (D && !llvm::isa<clang::TranslationUnitDecl>(D) && !Scope.contains(D)) return true;
+            return clang::RecursiveASTVisitor<DefinitionCollector>::TraverseDecl(D);
+        }
+
+        bool VisitFunctionDecl(clang::FunctionDecl* FD) {
+            if (FD->isThisDeclarationADefinition() && FD->hasBody() && Scope.contains(FD)) {
+                Definitions.push_back(FD);
+            }
+            return true;
+        }
+
+        AnalysisScope::Filter Scope;
+        std::vector<const clang::FunctionDecl*> Definitions;
+    };
+
+} // namespace
+
+namespace CFGAnalyzer {
+
+std::shared_ptr<AnalysisSession> AnalysisSession::forFile(const std::string& filename) {
+    // Each session holds a whole AST, so only a handful are kept
+    constexpr size_t MaxSessions = 4;
+    static std::mutex poolMutex;
+    static std::list<std::pair<std::string, std::shared_ptr<AnalysisSession>>> pool;
+
+    std::lock_guard<std::mutex> lock(poolMutex);
+    for (auto it = pool.begin(); it != pool.end(); ++it) {
+        if (it->first == filename) {
+            pool.splice(pool.begin(), pool, it);
+            return pool.front().second;
+        }
+    }
+
+    pool.emplace_front(filename, std::make_shared<AnalysisSession>());
+    if (pool.size() > MaxSessions) {
+        pool.pop_back();
+    }
+    return pool.front().second;
+}
+
+bool AnalysisSession::open(const std::string& filename,
+                           std::shared_ptr<const clang::tooling::CompilationDatabase> compilations) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    if (!compilations && m_filename == filename) {
+        compilations = m_compilations;
+    }
+    // The contents, not the timestamp, decide whether the AST is stale: modification
+    // times can be as coarse as a second, and watch mode saves faster than that
+    uint64_t contentHash = 0;
+    bool readable = file_hash::hashFile(filename, contentHash);
+    if (m_ast && readable && m_filename == filename && m_compilations == compilations &&
+        m_contentHash == contentHash) {
+        return true;
+    }
+
+    m_cfgs.clear();
+    m_statements.reset();
+    m_functions.clear();
+    m_declsByUSR.clear();
+    m_functionsByName.clear();
+    m_filename = filename;
+    m_compilations = compilations;
+    m_contentHash = contentHash;
+
+    m_ast = Parser::parseFileWithAST(filename, compilations.get());
+    if (!m_ast) {
+        return false;
+    }
+    buildIndex();
+    return true;
+}
+
+void AnalysisSession::close() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_cfgs.clear();
+    m_statements.reset();
+    m_functions.clear();
+    m_declsByUSR.clear();
+    m_functionsByName.clear();
+    m_ast.reset();
+    m_filename.clear();
+    m_compilations.reset();
+    m_contentHash = 0;
+}
+
+bool AnalysisSession::isOpen() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_ast != nullptr;
+}
+
+std::string AnalysisSession::filename() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_filename;
+}
+
+std::vector<AnalysisSession::FunctionEntry> AnalysisSession::functions() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_functions;
+}
+
+std::vector<AnalysisSession::FunctionEntry> AnalysisSession::findFunctions(const std::string& name) const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    std::vector<FunctionEntry> matches;
+    auto range = m_functionsByName.equal_range(toLower(name));
+    for (auto it = range.first; it != range.second; ++it) {
+        matches.push_back(m_functions[it->second]);
+    }
+    // Keep source order so the first match is the first definition in the file
+    std::sort(matches.begin(), matches.end(), [](const FunctionEntry& a, const FunctionEntry& b) {
+        return a.line < b.line;
+    });
+    return matches;
+}
+
+std::shared_ptr<GraphGenerator::CFGGraph> AnalysisSession::functionCFG(const std::string& usr) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    auto cached = m_cfgs.find(usr);
+    if (cached != m_cfgs.end()) {
+        return cached->second;
+    }
+
+    auto decl = m_declsByUSR.find(usr);
+    if (decl == m_declsByUSR.end()) {
+        return nullptr;
+    }
+
+    std::shared_ptr<GraphGenerator::CFGGraph> graph = GraphGenerator::generateCFG(
+        decl->second, GraphGenerator::StatementPool::acquire(m_statements));
+    if (graph) {
+        m_cfgs[usr] = graph;
+    }
+    return graph;
+}
+
+bool AnalysisSession::withContext(const std::function<void(clang::ASTContext&)>& fn) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (!m_ast) {
+        return false;
+    }
+    fn(m_ast->getASTContext());
+    return true;
+}
+
+void AnalysisSession::buildIndex() {
+    clang::ASTContext& context = m_ast->getASTContext();
+    const clang::SourceManager& SM = context.getSourceManager();
+    DefinitionCollector collector(SM);
+    collector.TraverseDecl(context.getTranslationUnitDecl());
+
+    for (const clang::FunctionDecl* FD : collector.Definitions) {
+        llvm::SmallString<128> usr;
+        if (clang::index::generateUSRForDecl(FD, usr)) {
+            continue;
+        }
+
+        FunctionEntry entry;
+        entry.usr = std::string(usr.str());
+        entry.name = FD->getQualifiedNameAsString();
+        entry.signature = entry.name + "(";
+        for (unsigned i = 0; i < FD->getNumParams(); ++i) {
+            if (i > 0) entry.signature += ", ";
+            entry.signature += FD->getParamDecl(i)->getType().getAsString();
+        }
+        entry.signature += ")";
+        entry.line = SM.getPresumedLineNumber(FD->getLocation());
+        entry.bodyHash = llvm::xxHash64(clang::Lexer::getSourceText(
+            clang::CharSourceRange::getTokenRange(FD->getSourceRange()), SM, context.getLangOpts()));
+
+        if (!m_declsByUSR.emplace(entry.usr, FD).second) {
+            continue;
+        }
+
+        size_t index = m_functions.size();
+        m_functionsByName.emplace(toLower(entry.name), index);
+        std::string shortName = toLower(FD->getNameAsString());
+        if (shortName != toLower(entry.name)) {
+            m_functionsByName.emplace(shortName, index);
+        }
+        m_functions.push_back(std::move(entry));
+    }
+}
+
+} // namespace CFGAnalyzer
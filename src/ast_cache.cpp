@@ -0,0 +1,295 @@
+#include "ast_cache.h"
+#include "file_hash.h"
+#include <clang/Basic/SourceManager.h>
+#include <clang/Basic/Version.h>
+#include <clang/Frontend/CompilerInstance.h>
+#include <clang/Serialization/PCHContainerOperations.h>
+#include <clang/Tooling/Tooling.h>
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/MemoryBuffer.h>
+#include <llvm/Support/Path.h>
+#include <llvm/Support/xxhash.h>
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <QDebug>
+
+using file_hash::hashFile;
+using file_hash::tempSuffix;
+using file_hash::toHex;
+
+ASTCache& ASTCache::instance() {
+    static ASTCache cache;
+    return cache;
+}
+
+ASTCache::ASTCache()
+    : m_enabled(true),
+      m_maxSize(uint64_t(1) << 30),
+      m_pchOperations(std::make_shared<clang::PCHContainerOperations>()),
+      m_totalSize(0),
+      m_sizeKnown(false) {
+    llvm::SmallString<128> dir;
+    llvm::sys::path::system_temp_directory(true, dir);
+    llvm::sys::path::append(dir, "cfgparser-ast");
+    m_directory = std::string(dir.str());
+}
+
+void ASTCache::setEnabled(bool enabled) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_enabled = enabled;
+}
+
+bool ASTCache::isEnabled() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_enabled;
+}
+
+void ASTCache::setCacheDirectory(const std::string& directory) {
+    std::lock_guard<std::mutex> evictLock(m_evictMutex);
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_directory = directory;
+    m_sizeKnown = false;
+}
+
+std::string ASTCache::cacheDirectory() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_directory;
+}
+
+void ASTCache::setMaxSize(uint64_t bytes) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_maxSize = bytes;
+}
+
+uint64_t ASTCache::maxSize() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_maxSize;
+}
+
+std::string ASTCache::keyFor(const clang::tooling::CompileCommand& command) const {
+    llvm::SmallString<256> mainFile(command.Filename);
+    if (!llvm::sys::path::is_absolute(mainFile)) {
+        llvm::sys::path::make_absolute(command.Directory, mainFile);
+    }
+
+    uint64_t contentHash = 0;
+    if (!hashFile(std::string(mainFile.str()), contentHash)) return "";
+
+    // Includes are not part of the key; they are checked against the entry's manifest
+    std::string keyText = clang::getClangFullVersion() + '\0' + command.Directory;
+    for (const std::string& arg : command.CommandLine) {
+        keyText += '\0' + arg;
+    }
+    keyText += '\0' + toHex(contentHash);
+    return toHex(llvm::xxHash64(keyText));
+}
+
+std::string ASTCache::entryPath(const std::string& key) const {
+    llvm::SmallString<256> path(cacheDirectory());
+    llvm::sys::path::append(path, key);
+    return std::string(path.str());
+}
+
+bool ASTCache::inputsUnchanged(const std::string& manifestPath) const {
+    std::ifstream manifest(manifestPath);
+    if (!manifest.is_open()) return false;
+
+    // One "<xxhash> <path>" line per file the TU read, main file included
+    std::string line;
+    while (std::getline(manifest, line)) {
+        std::istringstream fields(line);
+        std::string expected, path;
+        if (!(fields >> expected)) return false;
+        std::getline(fields >> std::ws, path);
+
+        uint64_t hash = 0;
+        if (!hashFile(path, hash) || toHex(hash) != expected) return false;
+    }
+    return true;
+}
+
+std::unique_ptr<clang::ASTUnit> ASTCache::load(const clang::tooling::CompilationDatabase& compilations,
+                                               const std::string& file) {
+    if (!isEnabled()) return nullptr;
+
+    auto commands = compilations.getCompileCommands(file);
+    if (commands.empty()) return nullptr;
+
+    std::string key = keyFor(commands.front());
+    if (key.empty()) return nullptr;
+
+    std::string base = entryPath(key);
+    std::string astPath = base + ".ast";
+    if (!llvm::sys::fs::exists(astPath) || !inputsUnchanged(base + ".inputs")) return nullptr;
+
+    clang::FileSystemOptions fileSystemOptions;
+    fileSystemOptions.WorkingDir = commands.front().Directory;
+    auto diagnostics = clang::CompilerInstance::createDiagnostics(
+        new clang::DiagnosticOptions(), new clang::IgnoringDiagConsumer());
+
+    std::unique_ptr<clang::ASTUnit> unit = clang::ASTUnit::LoadFromASTFile(
+        astPath, m_pchOperations->getRawReader(), clang::ASTUnit::LoadEverything,
+        diagnostics, fileSystemOptions);
+    if (!unit) {
+        // Stale or from an incompatible build; drop it so it gets rebuilt
+        llvm::sys::fs::remove(astPath);
+        llvm::sys::fs::remove(base + ".inputs");
+        return nullptr;
+    }
+
+    // Hits count as a use for LRU eviction
+    std::error_code ec;
+    std::filesystem::last_write_time(astPath, std::filesystem::file_time_type::clock::now(), ec);
+    return unit;
+}
+
+std::unique_ptr<clang::ASTUnit> ASTCache::loadOrBuild(const clang::tooling::CompilationDatabase& compilations,
+                                                      const std::string& file,
+                                                      const std::vector<clang::tooling::ArgumentsAdjuster>& adjusters) {
+    if (std::unique_ptr<clang::ASTUnit> cached = load(compilations, file)) {
+        return cached;
+    }
+
+    clang::tooling::ClangTool tool(compilations, {file});
+    for (const auto& adjuster : adjusters) {
+        tool.appendArgumentsAdjuster(adjuster);
+    }
+
+    std::vector<std::unique_ptr<clang::ASTUnit>> units;
+    if (tool.buildASTs(units) != 0 || units.empty() || !units.front()) {
+        return nullptr;
+    }
+    std::unique_ptr<clang::ASTUnit> unit = std::move(units.front());
+
+    // ASTs with errors are not worth keeping; the file is about to change anyway
+    if (isEnabled() && !unit->getDiagnostics().hasErrorOccurred()) {
+        auto commands = compilations.getCompileCommands(file);
+        std::string key = commands.empty() ? "" : keyFor(commands.front());
+        uint64_t bytes = 0;
+        if (!key.empty() && store(*unit, key, bytes)) {
+            noteStored(bytes);
+        }
+    }
+    return unit;
+}
+
+bool ASTCache::store(clang::ASTUnit& unit, const std::string& key, uint64_t& bytes) {
+    llvm::sys::fs::create_directories(cacheDirectory());
+    std::string base = entryPath(key);
+    std::string manifestTemp = base + ".inputs" + tempSuffix();
+    std::string astTemp = base + ".ast" + tempSuffix();
+
+    {
+        // Hash the buffers clang actually parsed, not whatever is on disk by now
+        std::ofstream manifest(manifestTemp, std::ios::trunc);
+        if (!manifest.is_open()) return false;
+
+        const clang::SourceManager& SM = unit.getSourceManager();
+        for (auto it = SM.fileinfo_begin(); it != SM.fileinfo_end(); ++it) {
+            const clang::FileEntry* entry = it->first;
+            std::string path = entry->tryGetRealPathName().str();
+            if (path.empty()) path = entry->getName().str();
+
+            uint64_t hash = 0;
+            if (auto buffer = it->second->getBufferIfLoaded()) {
+                hash = llvm::xxHash64(buffer->getBuffer());
+            } else if (!hashFile(path, hash)) {
+                manifest.close();
+                llvm::sys::fs::remove(manifestTemp);
+                return false;
+            }
+            manifest << toHex(hash) << ' ' << path << '\n';
+        }
+    }
+
+    // Save() returns true on failure
+    if (unit.Save(astTemp)) {
+        llvm::sys::fs::remove(manifestTemp);
+        llvm::sys::fs::remove(astTemp);
+        qWarning() << "Could not write cached AST for" << unit.getMainFileName().str().c_str();
+        return false;
+    }
+
+    uint64_t astSize = 0, manifestSize = 0;
+    llvm::sys::fs::file_size(astTemp, astSize);
+    llvm::sys::fs::file_size(manifestTemp, manifestSize);
+    bytes = astSize + manifestSize;
+
+    // Entries are only read once the .ast exists, so it goes into place last
+    if (llvm::sys::fs::rename(manifestTemp, base + ".inputs") ||
+        llvm::sys::fs::rename(astTemp, base + ".ast")) {
+        llvm::sys::fs::remove(manifestTemp);
+        llvm::sys::fs::remove(astTemp);
+        return false;
+    }
+    return true;
+}
+
+void ASTCache::noteStored(uint64_t bytes) {
+    std::lock_guard<std::mutex> lock(m_evictMutex);
+    if (m_sizeKnown) {
+        // A replaced entry is counted twice until the next scan, which only makes it sooner
+        m_totalSize += bytes;
+        if (m_totalSize <= maxSize()) return;
+    }
+    scanAndTrim();
+}
+
+void ASTCache::evict() {
+    std::lock_guard<std::mutex> lock(m_evictMutex);
+    scanAndTrim();
+}
+
+void ASTCache::scanAndTrim() {
+    namespace fs = std::filesystem;
+
+    struct Entry {
+        fs::path astPath;
+        fs::file_time_type lastUse;
+        uint64_t size;
+    };
+
+    std::vector<Entry> entries;
+    uint64_t totalSize = 0;
+    std::error_code ec;
+    for (fs::directory_iterator it(cacheDirectory(), ec), end; !ec && it != end; it.increment(ec)) {
+        if (it->path().extension() != ".ast") continue;
+
+        fs::path manifestPath = it->path();
+        manifestPath.replace_extension(".inputs");
+
+        std::error_code statError;
+        Entry entry{it->path(), fs::last_write_time(it->path(), statError), 0};
+        if (statError) continue;
+        entry.size = fs::file_size(it->path(), statError);
+        if (statError) continue;
+        uint64_t manifestSize = fs::file_size(manifestPath, statError);
+        if (!statError) entry.size += manifestSize;
+
+        totalSize += entry.size;
+        entries.push_back(std::move(entry));
+    }
+
+    m_totalSize = totalSize;
+    m_sizeKnown = true;
+    uint64_t limit = maxSize();
+    if (totalSize <= limit) return;
+
+    // Trim to 90% of the limit so the next few stores don't each trigger a scan
+    uint64_t target = limit - limit / 10;
+    std::sort(entries.begin(), entries.end(), [](const Entry& a, const Entry& b) {
+        return a.lastUse < b.lastUse;
+    });
+    for (const Entry& entry : entries) {
+        if (totalSize <= target) break;
+
+        fs::path manifestPath = entry.astPath;
+        manifestPath.replace_extension(".inputs");
+        fs::remove(entry.astPath, ec);
+        fs::remove(manifestPath, ec);
+        totalSize -= entry.size;
+    }
+    m_totalSize = totalSize;
+}
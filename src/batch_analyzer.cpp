@@ -0,0 +1,172 @@
+#include "batch_analyzer.h"
+#include "ast_cache.h"
+#include "cfg_registry.h"
+#include "compile_commands.h"
+#include "graph_generator.h"
+#include "parser.h"
+#include "preamble_cache.h"
+#include <llvm/Support/Path.h>
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <QDebug>
+
+namespace CFGAnalyzer {
+
+BatchAnalyzer::BatchAnalyzer(unsigned workerCount)
+    : m_workerCount(0), m_outputDir("cfg_output"), m_populateASTCache(false) {
+    setWorkerCount(workerCount);
+}
+
+void BatchAnalyzer::setWorkerCount(unsigned workerCount) {
+    if (workerCount == 0) {
+        workerCount = std::max(1u, std::thread::hardware_concurrency());
+    }
+    m_workerCount = workerCount;
+}
+
+unsigned BatchAnalyzer::workerCount() const {
+    return m_workerCount;
+}
+
+void BatchAnalyzer::setCompilationDatabase(
+    std::shared_ptr<const clang::tooling::CompilationDatabase> compilations) {
+    m_compilations = std::move(compilations);
+}
+
+void BatchAnalyzer::setOutputDirectory(const std::string& outputDir) {
+    m_outputDir = outputDir;
+}
+
+void BatchAnalyzer::setProgressCallback(ProgressCallback callback) {
+    m_progress = std::move(callback);
+}
+
+void BatchAnalyzer::setPopulateASTCache(bool populate) {
+    m_populateASTCache = populate;
+}
+
+void BatchAnalyzer::setRunContext(const RunContext& run) {
+    m_run = run;
+}
+
+AnalysisResult BatchAnalyzer::analyzeFiles(const std::vector<std::string>& sources) {
+    AnalysisResult merged;
+    if (sources.empty()) {
+        merged.report = "No translation units to analyze";
+        return merged;
+    }
+
+    auto compilations = CompileCommands::orDefault(m_compilations);
+    std::vector<clang::tooling::ArgumentsAdjuster> adjusters = {
+        CompileCommands::resourceDirAdjuster(),
+        PreambleCache::instance().adjuster(compilations.get())
+    };
+    std::atomic<size_t> nextIndex{0};
+    std::atomic<size_t> finished{0};
+    std::atomic<size_t> failures{0};
+    // One slot per TU, merged in source order once all workers are done, so which TU's
+    // CFG a function name ends up with does not depend on which worker finished first
+    std::vector<AnalysisResult> tuResults(sources.size());
+    // Header CFGs shared between the TUs of this call only
+    CFGRegistry registry;
+    RunContext run = m_run;
+    run.registry = &registry;
+
+    // Workers pull the next TU index themselves, so a slow TU never holds up the others
+    auto runWorker = [&]() {
+        Parser::ThreadLocalState state;
+
+        for (size_t i = nextIndex++; i < sources.size(); i = nextIndex++) {
+            const std::string& file = sources[i];
+            AnalysisResult& tuResult = tuResults[i];
+            bool ok = false;
+
+            try {
+                // Cached TUs skip Sema entirely. Misses run on the worker's CompilerInstance,
+                // unless the cache is to be filled: saving needs an ASTUnit of its own.
+                std::unique_ptr<clang::ASTUnit> ast = m_populateASTCache
+                    ? ASTCache::instance().loadOrBuild(*compilations, file, adjusters)
+                    : ASTCache::instance().load(*compilations, file);
+                if (ast) {
+                    clang::ASTContext& context = ast->getASTContext();
+                    CFGConsumer consumer(&context, m_outputDir, tuResult, run);
+                    consumer.HandleTranslationUnit(context);
+                    ok = true;
+                } else if (!m_populateASTCache || !ASTCache::instance().isEnabled()) {
+                    CFGAction action(m_outputDir, tuResult, run);
+                    ok = state.execute(file, compilations.get(), action);
+                }
+            } catch (const std::exception& e) {
+                qWarning() << "Batch analysis of" << file.c_str() << "failed:" << e.what();
+            }
+
+            if (ok) {
+                tuResult.success = true;
+            } else {
+                tuResult = AnalysisResult();
+                ++failures;
+            }
+
+            size_t done = ++finished;
+            if (m_progress) {
+                m_progress(file, ok, done, sources.size());
+            }
+        }
+    };
+
+    unsigned threadCount = static_cast<unsigned>(
+        std::min<size_t>(m_workerCount, sources.size()));
+    std::vector<std::thread> workers;
+    workers.reserve(threadCount);
+    for (unsigned i = 0; i < threadCount; ++i) {
+        workers.emplace_back(runWorker);
+    }
+    for (auto& worker : workers) {
+        worker.join();
+    }
+    std::set<std::string> collisions;
+    for (size_t i = 0; i < tuResults.size(); ++i) {
+        if (tuResults[i].success) {
+            mergeResult(merged, std::move(tuResults[i]), sources[i], collisions);
+        }
+    }
+
+    merged.success = failures < sources.size();
+    if (failures > 0) {
+        merged.report = std::to_string(failures) + " of " + std::to_string(sources.size()) +
+                        " translation units failed to parse";
+    }
+    if (!collisions.empty()) {
+        if (!merged.report.empty()) merged.report += "; ";
+        merged.report += std::to_string(collisions.size()) +
+                         " function names have different definitions in several translation units:";
+        size_t listed = 0;
+        for (const auto& name : collisions) {
+            if (listed++ == 5) {
+                merged.report += " ...";
+                break;
+            }
+            merged.report += " " + name;
+        }
+    }
+    return merged;
+}
+
+void BatchAnalyzer::mergeResult(AnalysisResult& into, AnalysisResult&& from,
+                                const std::string& source, std::set<std::string>& collisions) {
+    for (auto& [caller, callees] : from.functionDependencies) {
+        into.functionDependencies[caller].insert(callees.begin(), callees.end());
+    }
+    for (auto& [name, graph] : from.functionCFGs) {
+        auto [it, inserted] = into.functionCFGs.emplace(name, graph);
+        if (inserted || !graph || !it->second || it->second->contentHash() == graph->contentHash()) {
+            continue;
+        }
+        collisions.insert(name);
+        into.functionCFGs.emplace(name + " (" + llvm::sys::path::filename(source).str() + ")",
+                                  std::move(graph));
+    }
+}
+
+} // namespace CFGAnalyzer
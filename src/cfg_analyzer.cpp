@@ -3,47 +3,151 @@
 #include "cfg_analyzer.h"
 #include "parser.h"
 #include "graph_generator.h"
-#include "visualizer.h"
+#include "compile_commands.h"
+#include "batch_analyzer.h"
+#include "preamble_cache.h"
+#include "analysis_session.h"
+#include "ast_cache.h"
+#include "cfg_registry.h"
+#include "cfg_binary.h"
+#include "cfg_bundle.h"
+#include "dot_writer.h"
+#include "json_writer.h"
+#include "output_writer.h"
 #include <QString>
+#include <clang/Frontend/ASTUnit.h>
 #include <clang/Tooling/Tooling.h>
 #include <clang/Tooling/CommonOptionsParser.h>
 #include <llvm/Support/CommandLine.h>
 #include <llvm/Support/FileSystem.h>
+#include <llvm/Support/Path.h>
+#include <llvm/Support/xxhash.h>
+#include <algorithm>
 #include <iomanip>
 #include <chrono>
 #include <ctime>
-#include <nlohmann/json.hpp>
-
-using json = nlohmann::json;
 
 namespace CFGAnalyzer {
 
+namespace {
+
+    // Entries of an unordered map in key order, so outputs do not follow hash order
+    template <typename Map>
+    std::vector<const typename Map::value_type*> sortedByKey(const Map& map) {
+        std::vector<const typename Map::value_type*> entries;
+        entries.reserve(map.size());
+        for (const auto& entry : map) {
+            entries.push_back(&entry);
+        }
+        std::sort(entries.begin(), entries.end(), [](const auto* a, const auto* b) {
+            return a->first < b->first;
+        });
+        return entries;
+    }
+
+} // namespace
+
+std::shared_ptr<const GraphGenerator::CFGGraph> buildCallGraph(
+    const std::unordered_map<std::string, std::set<std::string>>& functionDependencies) {
+    std::vector<std::string_view> names;
+    for (const auto& [caller, callees] : functionDependencies) {
+        names.push_back(caller);
+        names.insert(names.end(), callees.begin(), callees.end());
+    }
+    std::sort(names.begin(), names.end());
+    names.erase(std::unique(names.begin(), names.end()), names.end());
+
+    auto graph = std::make_shared<GraphGenerator::CFGGraph>();
+    std::unordered_map<std::string_view, int> ids;
+    ids.reserve(names.size());
+    for (size_t i = 0; i < names.size(); ++i) {
+        ids.emplace(names[i], static_cast<int>(i));
+        graph->addNode(static_cast<int>(i), std::string(names[i]));
+    }
+    for (const auto& [caller, callees] : functionDependencies) {
+        for (const auto& callee : callees) {
+            graph->addEdge(ids[caller], ids[callee]);
+        }
+    }
+    graph->finalize();
+    return graph;
+}
+
+uint64_t contentHash(const AnalysisResult& result) {
+    // Names end in '\0', which no C++ name contains; graph hashes are fixed-size
+    std::string buffer;
+    for (const auto* entry : sortedByKey(result.functionDependencies)) {
+        buffer.append(entry->first).push_back('\0');
+        for (const auto& callee : entry->second) {
+            buffer.append(callee).push_back('\0');
+        }
+        buffer.push_back('\0');
+    }
+    buffer.push_back('\0');
+    for (const auto* entry : sortedByKey(result.functionCFGs)) {
+        buffer.append(entry->first).push_back('\0');
+        uint64_t hash = entry->second ? entry->second->contentHash() : 0;
+        buffer.append(reinterpret_cast<const char*>(&hash), sizeof(hash));
+    }
+    return llvm::xxHash64(llvm::StringRef(buffer.data(), buffer.size()));
+}
+
 CFGVisitor::CFGVisitor(clang::ASTContext* Context,
                      const std::string& outputDir,
-                     AnalysisResult& results)
+                     AnalysisResult& results,
+                     const RunContext& run)
     : Context(Context), 
       OutputDir(outputDir), 
-      m_results(results) 
+      m_results(results),
+      Run(run),
+      Scope(AnalysisScope::current(), Context->getSourceManager())
 {
     if (!llvm::sys::fs::exists(outputDir)) {
         llvm::sys::fs::create_directory(outputDir);
     }
 }
 
+bool CFGVisitor::TraverseDecl(clang::Decl* D) {
+    if (D && !llvm::isa<clang::TranslationUnitDecl>(D) && !Scope.contains(D)) {
+        return true;
+    }
+    return clang::RecursiveASTVisitor<CFGVisitor>::TraverseDecl(D);
+}
+
 bool CFGVisitor::VisitFunctionDecl(clang::FunctionDecl* FD) {
     if (!FD || !FD->hasBody()) return true;
-    
-    clang::SourceManager& SM = Context->getSourceManager();
-    if (!SM.isInMainFile(FD->getLocation())) return true;
+    if (!Scope.contains(FD)) return true;
     
     std::string funcName = FD->getQualifiedNameAsString();
     CurrentFunction = funcName;
     FunctionDependencies[funcName] = std::set<std::string>();
     
+    // Header functions seen from several TUs of a run share one CFG and one output file.
+    // A main file's functions are seen by this TU only, so they are not kept in the registry.
     std::string funcFilename = OutputDir + "/" + funcName + "_cfg.dot";
-    auto cfgGraph = GraphGenerator::generateCFG(FD);
+    std::string key = CFGRegistry::keyFor(FD);
+    const clang::SourceManager& SM = Context->getSourceManager();
+    std::shared_ptr<const GraphGenerator::CFGGraph> cfgGraph;
+    if (!Run.registry || SM.isInMainFile(SM.getExpansionLoc(FD->getLocation()))) {
+        cfgGraph = GraphGenerator::generateCFG(FD, GraphGenerator::StatementPool::acquire(Statements));
+    } else {
+        cfgGraph = Run.registry->getOrBuild(key, FD, GraphGenerator::StatementPool::acquire(Statements));
+    }
     if (cfgGraph) {
-        Visualizer::exportToDot(cfgGraph.get(), funcFilename);
+        // Written in the background; traversal does not wait for the file system. A bundle
+        // is rebuilt every run and drops repeated USRs itself; separate files are only
+        // rewritten when they do not hold this definition yet.
+        OutputWriter& writer = OutputWriter::instance();
+        if (Run.bundle) {
+            writer.submitFunction(Run.bundle, funcName, key.substr(0, key.find('|')), cfgGraph,
+                                  Run.outputs);
+        } else if (CFGOutputIndex::instance().claimOutput(key, funcFilename)) {
+            writer.submitDot(funcFilename, cfgGraph, Run.outputs,
+                             [key, funcFilename](bool written) {
+                                 CFGOutputIndex::instance().outputWritten(key, funcFilename, written);
+                             });
+        }
+        m_results.functionCFGs[funcName] = std::move(cfgGraph);
     }
     
     return true;
@@ -61,9 +165,9 @@ bool CFGVisitor::VisitCallExpr(clang::CallExpr* CE) {
 
 void CFGVisitor::PrintFunctionDependencies() const {
     llvm::outs() << "Function Dependencies:\n";
-    for (const auto& [caller, callees] : FunctionDependencies) {
-        llvm::outs() << caller << " calls:\n";
-        for (const auto& callee : callees) {
+    for (const auto* entry : sortedByKey(FunctionDependencies)) {
+        llvm::outs() << entry->first << " calls:\n";
+        for (const auto& callee : entry->second) {
             llvm::outs() << "  - " << callee << "\n";
         }
     }
@@ -74,130 +178,274 @@ CFGVisitor::GetFunctionDependencies() const {
     return FunctionDependencies;
 }
 
-void CFGVisitor::FinalizeCombinedFile() {
-    std::string combinedFilename = OutputDir + "/combined_cfg.dot";
-    if (llvm::sys::fs::exists(combinedFilename)) {
-        std::ofstream outFile(combinedFilename, std::ios::app);
-        if (outFile.is_open()) {
-            outFile << "}\n";
-            outFile.close();
-        }
+void CFGVisitor::FinalizeResults() {
+    // Several TUs may feed the same result in project mode
+    for (const auto& [caller, callees] : FunctionDependencies) {
+        m_results.functionDependencies[caller].insert(callees.begin(), callees.end());
     }
-    
-    m_results.functionDependencies = FunctionDependencies;
 }
 
 CFGConsumer::CFGConsumer(clang::ASTContext* Context,
                        const std::string& outputDir,
-                       AnalysisResult& results)
-    : Visitor(std::make_unique<CFGVisitor>(Context, outputDir, results)) {}
+                       AnalysisResult& results,
+                       const RunContext& run)
+    : Visitor(std::make_unique<CFGVisitor>(Context, outputDir, results, run)) {}
 
 void CFGConsumer::HandleTranslationUnit(clang::ASTContext& Context) {
     Visitor->TraverseDecl(Context.getTranslationUnitDecl());
-    Visitor->FinalizeCombinedFile();
+    Visitor->FinalizeResults();
 }
 
 CFGAction::CFGAction(const std::string& outputDir,
-                   AnalysisResult& results)
-    : OutputDir(outputDir), m_results(results) {}
+                   AnalysisResult& results,
+                   const RunContext& run)
+    : OutputDir(outputDir), m_results(results), Run(run) {}
 
 std::unique_ptr<clang::ASTConsumer> CFGAction::CreateASTConsumer(
     clang::CompilerInstance& CI, llvm::StringRef File) {
-    return std::make_unique<CFGConsumer>(&CI.getASTContext(), OutputDir, m_results);
+    return std::make_unique<CFGConsumer>(&CI.getASTContext(), OutputDir, m_results, Run);
+}
+
+bool CFGAnalyzer::loadCompilationDatabase(const std::string& path, std::string& errorMessage) {
+    auto compilations = CompileCommands::load(path, errorMessage);
+    if (!compilations) {
+        return false;
+    }
+    setCompilationDatabase(std::move(compilations));
+    return true;
+}
+
+void CFGAnalyzer::setCompilationDatabase(
+    std::shared_ptr<const clang::tooling::CompilationDatabase> compilations) {
+    m_compilations = std::move(compilations);
 }
 
 AnalysisResult CFGAnalyzer::analyze(const std::string& filename) {
+    return analyzeSources({filename});
+}
+
+AnalysisResult CFGAnalyzer::analyzeProject() {
+    if (!m_compilations) {
+        AnalysisResult result;
+        result.report = "No compilation database loaded";
+        return result;
+    }
+
+    std::vector<std::string> sources = m_compilations->getAllFiles();
+    if (sources.empty()) {
+        AnalysisResult result;
+        result.report = "Compilation database contains no translation units";
+        return result;
+    }
+    return analyzeFiles(sources);
+}
+
+AnalysisResult CFGAnalyzer::analyzeFiles(const std::vector<std::string>& sources) {
+    RunContext run = beginOutput();
+    BatchAnalyzer batch(m_workerCount);
+    batch.setCompilationDatabase(m_compilations);
+    batch.setProgressCallback(m_progress);
+    batch.setPopulateASTCache(m_populateASTCache);
+    batch.setRunContext(run);
+
+    AnalysisResult result = batch.analyzeFiles(sources);
+    if (!result.success) {
+        finishOutput(result, run);
+        return result;
+    }
+
+    // All CFGs of the run in one mappable file, so the GUI can reopen them without parsing
+    std::vector<std::pair<std::string, const GraphGenerator::CFGGraph*>> functions;
+    functions.reserve(result.functionCFGs.size());
+    for (const auto& [name, graph] : result.functionCFGs) {
+        functions.emplace_back(name, graph.get());
+    }
+    llvm::sys::fs::create_directories("cfg_output");
+    GraphGenerator::writeBinaryCFGFile(
+        std::string("cfg_output/project") + GraphGenerator::BinaryCFG::FileSuffix, functions);
+
+    std::string failures = result.report;
+    result.callGraph = buildCallGraph(result.functionDependencies);
+    result.report = generateReport(result);
+    result.contentHash = contentHash(result);
+    result.generatedAt = getCurrentDateTime();
+    if (!failures.empty()) {
+        result.report += "Warning: " + failures + "\n";
+    }
+    finishOutput(result, run);
+    return result;
+}
+
+RunContext CFGAnalyzer::beginOutput() const {
+    RunContext run;
+    run.outputs = std::make_shared<OutputTicket>();
+    if (!m_bundlePath.empty()) {
+        llvm::sys::fs::create_directories(llvm::sys::path::parent_path(m_bundlePath));
+        auto bundle = std::make_shared<GraphGenerator::BundleWriter>(m_bundlePath, m_compressBundle);
+        if (bundle->isOpen()) run.bundle = std::move(bundle);
+    }
+    return run;
+}
+
+void CFGAnalyzer::finishOutput(AnalysisResult& result, const RunContext& run) const {
+    // The outputs of this run are complete once the result is. Once its jobs are written
+    // nothing else holds the bundle, which only this run wrote to.
+    size_t unwritten = OutputWriter::instance().flush(run.outputs);
+    // Only now does the index record what this run actually wrote
+    CFGOutputIndex::instance().saveIndex();
+    if (run.bundle && !run.bundle->finish()) {
+        result.report += "Warning: could not write " + m_bundlePath + "\n";
+    }
+    if (unwritten) {
+        result.report += "Warning: " + std::to_string(unwritten) + " output files could not be written\n";
+    }
+}
+
+AnalysisResult CFGAnalyzer::analyzeUnsaved(const std::string& filename,
+                                           const Parser::UnsavedFiles& unsavedFiles) {
     AnalysisResult result;
-    std::vector<std::string> CommandLine = {
-        "-std=c++17",
-        "-I.",
-        "-I/usr/include",
-        "-I/usr/local/include"
-    };
+    QMutexLocker locker(&m_analysisMutex);
+    m_results = AnalysisResult();
 
-    auto Compilations = std::make_unique<clang::tooling::FixedCompilationDatabase>(
-        ".", CommandLine);
-    if (!Compilations) {
-        result.report = "Failed to create compilation database";
+    m_liveParser.setCompilationDatabase(m_compilations);
+    clang::ASTUnit* AST = m_liveParser.parseUnsaved(filename, unsavedFiles);
+    if (!AST) {
+        result.report = "Failed to parse " + filename;
         return result;
     }
 
-    std::vector<std::string> Sources{filename};
-    clang::tooling::ClangTool Tool(*Compilations, Sources);
+    RunContext run = beginOutput();
+    clang::ASTContext& Context = AST->getASTContext();
+    CFGConsumer Consumer(&Context, "cfg_output", m_results, run);
+    Consumer.HandleTranslationUnit(Context);
 
-    class CFGActionFactory : public clang::tooling::FrontendActionFactory {
-    public:
-        CFGActionFactory(AnalysisResult& results) : m_results(results) {}
-        
-        std::unique_ptr<clang::FrontendAction> create() override {
-            return std::make_unique<CFGAction>("cfg_output", m_results);
-        }
-        
-    private:
-        AnalysisResult& m_results;
+    collectResults(result, run);
+    return result;
+}
+
+AnalysisResult CFGAnalyzer::analyze(AnalysisSession& session) {
+    AnalysisResult result;
+    QMutexLocker locker(&m_analysisMutex);
+    m_results = AnalysisResult();
+
+    RunContext run = beginOutput();
+    bool parsed = session.withContext([this, &run](clang::ASTContext& Context) {
+        CFGConsumer Consumer(&Context, "cfg_output", m_results, run);
+        Consumer.HandleTranslationUnit(Context);
+    });
+    if (!parsed) {
+        result.report = "Analysis failed: no parsed file in session";
+        finishOutput(result, run);
+        return result;
+    }
+
+    collectResults(result, run);
+    return result;
+}
+
+AnalysisResult CFGAnalyzer::analyzeFile(AnalysisSession& session) {
+    AnalysisResult result;
+    try {
+        result = analyze(session);
+    }
+    catch (const std::exception& e) {
+        result.report = std::string("Analysis error: ") + e.what();
+        result.success = false;
+    }
+    return result;
+}
+
+void CFGAnalyzer::collectResults(AnalysisResult& result, const RunContext& run) const {
+    result.report = generateReport(m_results);
+    finishOutput(result, run);
+    result.functionDependencies = m_results.functionDependencies;
+    result.callGraph = buildCallGraph(m_results.functionDependencies);
+    result.functionCFGs = m_results.functionCFGs;
+    result.contentHash = contentHash(result);
+    result.generatedAt = getCurrentDateTime();
+    result.success = true;
+}
+
+AnalysisResult CFGAnalyzer::analyzeSources(const std::vector<std::string>& sources) {
+    AnalysisResult result;
+    {
+        QMutexLocker locker(&m_analysisMutex);
+        m_results = AnalysisResult();
+    }
+    // Header CFGs are shared between the TUs of this run only; the result keeps the
+    // graphs it needs, and with them their statement pools
+    CFGRegistry registry;
+    RunContext run = beginOutput();
+    run.registry = &registry;
+    auto Compilations = CompileCommands::orDefault(m_compilations);
+    std::vector<clang::tooling::ArgumentsAdjuster> Adjusters = {
+        CompileCommands::resourceDirAdjuster(),
+        PreambleCache::instance().adjuster(Compilations.get())
     };
 
-    CFGActionFactory factory(m_results);
-    int ToolResult = Tool.run(&factory);
+    // Each TU goes through the AST cache, so re-analyzing an unchanged file skips Sema
+    size_t Failures = 0;
+    for (const std::string& source : sources) {
+        std::unique_ptr<clang::ASTUnit> AST =
+            ASTCache::instance().loadOrBuild(*Compilations, source, Adjusters);
+        if (!AST) {
+            ++Failures;
+            continue;
+        }
+
+        clang::ASTContext& Context = AST->getASTContext();
+        CFGConsumer Consumer(&Context, "cfg_output", m_results, run);
+        Consumer.HandleTranslationUnit(Context);
+    }
     
-    if (ToolResult != 0) {
-        result.report = "Analysis failed with code: " + std::to_string(ToolResult);
+
+    // In project mode a few broken TUs should not throw away the rest
+    if (Failures > 0 && (sources.size() == 1 || m_results.functionDependencies.empty())) {
+        result.report = "Analysis failed for " + std::to_string(Failures) + " of " +
+                        std::to_string(sources.size()) + " translation units";
+        finishOutput(result, run);
         return result;
     }
 
     // Generate outputs
     {
         QMutexLocker locker(&m_analysisMutex);
-        result.dotOutput = generateDotOutput(m_results);
-        result.report = generateReport(m_results);
-        result.success = true;
+        collectResults(result, run);
     }
 
     return result;
 }
 
 std::string CFGAnalyzer::generateDotOutput(const AnalysisResult& result) const {
-    std::stringstream dotStream;
-    dotStream << "digraph FunctionDependencies {\n"
-              << "  node [shape=rectangle, style=filled, fillcolor=lightblue];\n"
-              << "  edge [arrowsize=0.8];\n"
-              << "  rankdir=LR;\n\n";
-
-    for (const auto& [caller, callees] : result.functionDependencies) {
-        dotStream << "  \"" << caller << "\";\n";
-        for (const auto& callee : callees) {
-            dotStream << "  \"" << caller << "\" -> \"" << callee << "\";\n";
+    size_t edgeCount = 0;
+    for (const auto& entry : result.functionDependencies) {
+        edgeCount += entry.second.size();
+    }
+
+    std::string dot;
+    DotWriter writer(dot);
+    writer.reserve(DotWriter::estimateSize(result.functionDependencies.size(), edgeCount * 2));
+    writer.beginGraph("FunctionDependencies")
+        .raw("  node [shape=rectangle, style=filled, fillcolor=lightblue];\n")
+        .raw("  edge [arrowsize=0.8];\n")
+        .raw("  rankdir=LR;\n\n");
+
+    for (const auto* entry : sortedByKey(result.functionDependencies)) {
+        const std::string& caller = entry->first;
+        writer.raw("  ").quoted(caller).raw(";\n");
+        for (const auto& callee : entry->second) {
+            writer.raw("  ").quoted(caller).raw(" -> ").quoted(callee).raw(";\n");
         }
     }
 
-    dotStream << "}\n";
-    return dotStream.str();
+    writer.endGraph();
+    return dot;
 }
 
 AnalysisResult CFGAnalyzer::analyzeFile(const QString& filePath) {
     AnalysisResult result;
     try {
-        std::string filename = filePath.toStdString();
-        result = analyze(filename);
-        
-        if (!result.success) {
-            return result;
-        }
-        
-        // Generate JSON output
-        json j;
-        j["filename"] = filename;
-        j["timestamp"] = getCurrentDateTime();
-        j["functions"] = json::array();
-        
-        for (const auto& [func, calls] : result.functionDependencies) {
-            json function;
-            function["name"] = func;
-            function["calls"] = calls;
-            j["functions"].push_back(function);
-        }
-        
-        result.jsonOutput = j.dump(2);
+        result = analyze(filePath.toStdString());
     }
     catch (const std::exception& e) {
         result.report = std::string("Analysis error: ") + e.what();
@@ -207,6 +455,29 @@ AnalysisResult CFGAnalyzer::analyzeFile(const QString& filePath) {
     return result;
 }
 
+std::string CFGAnalyzer::generateJsonOutput(const AnalysisResult& result,
+                                            const std::string& filename) const {
+    std::string output;
+    JsonWriter writer(output,
+                      m_prettyJson ? JsonWriter::Style::Pretty : JsonWriter::Style::Compact);
+
+    writer.beginObject()
+        .member("filename", filename)
+        .key("functions").beginArray();
+    for (const auto* entry : sortedByKey(result.functionDependencies)) {
+        writer.beginObject().key("calls").beginArray();
+        for (const auto& callee : entry->second) {
+            writer.value(callee);
+        }
+        writer.endArray()
+            .member("name", entry->first)
+            .endObject();
+    }
+    writer.endArray()
+        .endObject();
+    return output;
+}
+
 std::string CFGAnalyzer::getCurrentDateTime() {
     auto now = std::chrono::system_clock::now();
     auto in_time_t = std::chrono::system_clock::to_time_t(now);
@@ -221,13 +492,12 @@ std::string CFGAnalyzer::getCurrentDateTime() {
 
 std::string CFGAnalyzer::generateReport(const AnalysisResult& result) const {
     std::stringstream report;
-    report << "CFG Analysis Report\n";
-    report << "Generated: " << getCurrentDateTime() << "\n\n";
+    report << "CFG Analysis Report\n\n";
     report << "Function Dependencies:\n";
     
-    for (const auto& [caller, callees] : result.functionDependencies) {
-        report << caller << " calls:\n";
-        for (const auto& callee : callees) {
+    for (const auto* entry : sortedByKey(result.functionDependencies)) {
+        report << entry->first << " calls:\n";
+        for (const auto& callee : entry->second) {
             report << "  - " << callee << "\n";
         }
         report << "\n";
@@ -0,0 +1,297 @@
+#include "cfg_binary.h"
+#include "graph_generator.h"
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/xxhash.h>
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <numeric>
+#include <unordered_map>
+#include <QDebug>
+#include <QFile>
+
+namespace GraphGenerator {
+
+namespace {
+
+    constexpr uint64_t MaxCount = std::numeric_limits<uint32_t>::max();
+
+    // Each distinct string once; the views point into the graphs being written
+    class StringTable {
+    public:
+        BinaryCFG::TextRef add(std::string_view text) {
+            auto it = m_refs.find(text);
+            if (it != m_refs.end()) return it->second;
+
+            if (m_bytes.size() + text.size() > MaxCount) {
+                m_overflow = true;
+                return BinaryCFG::TextRef{0, 0};
+            }
+            BinaryCFG::TextRef ref{static_cast<uint32_t>(m_bytes.size()),
+                                   static_cast<uint32_t>(text.size())};
+            m_bytes.append(text.data(), text.size());
+            m_refs.emplace(text, ref);
+            return ref;
+        }
+
+        const std::string& bytes() const { return m_bytes; }
+        bool overflow() const { return m_overflow; }
+
+    private:
+        std::string m_bytes;
+        std::unordered_map<std::string_view, BinaryCFG::TextRef> m_refs;
+        bool m_overflow = false;
+    };
+
+    template <typename T>
+    void append(std::vector<char>& image, const std::vector<T>& records) {
+        const char* data = reinterpret_cast<const char*>(records.data());
+        image.insert(image.end(), data, data + records.size() * sizeof(T));
+    }
+
+} // namespace
+
+bool writeBinaryCFGFile(const std::string& filename,
+                        const std::vector<std::pair<std::string, const CFGGraph*>>& functions) {
+    // Sorted by name so readers can binary search; an index keeps the names in place
+    std::vector<size_t> order(functions.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::sort(order.begin(), order.end(), [&functions](size_t a, size_t b) {
+        return functions[a].first < functions[b].first;
+    });
+
+    StringTable strings;
+    std::vector<BinaryCFG::FunctionRecord> functionRecords;
+    std::vector<BinaryCFG::NodeRecord> nodeRecords;
+    std::vector<BinaryCFG::EdgeRecord> edgeRecords;
+    std::vector<BinaryCFG::TextRef> statementRefs;
+
+    for (size_t index : order) {
+        const auto& [name, graph] = functions[index];
+        if (!graph) continue;
+
+        BinaryCFG::FunctionRecord function{};
+        function.name = strings.add(name);
+        function.firstNode = static_cast<uint32_t>(nodeRecords.size());
+        function.nodeCount = static_cast<uint32_t>(graph->getNodeCount());
+
+        for (const auto& [nodeID, node] : graph->getNodes()) {
+            BinaryCFG::NodeRecord record{};
+            record.id = nodeID;
+            record.line = node.line;
+            record.label = strings.add(node.label);
+            record.firstEdge = static_cast<uint32_t>(edgeRecords.size());
+            record.edgeCount = static_cast<uint32_t>(node.successors.size());
+            record.firstStatement = static_cast<uint32_t>(statementRefs.size());
+            record.statementCount = static_cast<uint32_t>(node.statements.size());
+            if (graph->isNodeTryBlock(nodeID)) record.flags |= CFGGraph::TryBlockNode;
+            if (graph->isNodeThrowingException(nodeID)) record.flags |= CFGGraph::ThrowingNode;
+            nodeRecords.push_back(record);
+
+            for (int successorID : node.successors) {
+                edgeRecords.push_back({successorID, graph->getEdgeFlags(nodeID, successorID)});
+            }
+            for (std::string_view stmt : node.statements) {
+                statementRefs.push_back(strings.add(stmt));
+            }
+        }
+        functionRecords.push_back(function);
+    }
+
+    if (functionRecords.size() > MaxCount || nodeRecords.size() > MaxCount ||
+        edgeRecords.size() > MaxCount || statementRefs.size() > MaxCount || strings.overflow()) {
+        qWarning() << "CFGs too large for the binary format:" << filename.c_str();
+        return false;
+    }
+
+    BinaryCFG::Header header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, BinaryCFG::Magic, sizeof(header.magic));
+    header.version = BinaryCFG::Version;
+    header.byteOrder = BinaryCFG::ByteOrderMark;
+    header.functionCount = static_cast<uint32_t>(functionRecords.size());
+    header.nodeCount = nodeRecords.size();
+    header.edgeCount = edgeRecords.size();
+    header.statementCount = statementRefs.size();
+    header.stringBytes = strings.bytes().size();
+
+    // Whole image in memory, so the checksum is one pass and the file one write
+    std::vector<char> image(sizeof(header));
+    image.reserve(sizeof(header) +
+                  functionRecords.size() * sizeof(BinaryCFG::FunctionRecord) +
+                  nodeRecords.size() * sizeof(BinaryCFG::NodeRecord) +
+                  edgeRecords.size() * sizeof(BinaryCFG::EdgeRecord) +
+                  statementRefs.size() * sizeof(BinaryCFG::TextRef) +
+                  strings.bytes().size());
+    append(image, functionRecords);
+    append(image, nodeRecords);
+    append(image, edgeRecords);
+    append(image, statementRefs);
+    image.insert(image.end(), strings.bytes().begin(), strings.bytes().end());
+
+    header.checksum = llvm::xxHash64(
+        llvm::StringRef(image.data() + sizeof(header), image.size() - sizeof(header)));
+    std::memcpy(image.data(), &header, sizeof(header));
+
+    std::string tempPath = filename + ".tmp";
+    {
+        std::ofstream out(tempPath, std::ios::binary | std::ios::trunc);
+        if (!out.is_open()) {
+            qWarning() << "Could not write binary CFG file" << filename.c_str();
+            return false;
+        }
+        out.write(image.data(), static_cast<std::streamsize>(image.size()));
+        if (!out) {
+            qWarning() << "Could not write binary CFG file" << filename.c_str();
+            out.close();
+            llvm::sys::fs::remove(tempPath);
+            return false;
+        }
+    }
+    if (llvm::sys::fs::rename(tempPath, filename)) {
+        llvm::sys::fs::remove(tempPath);
+        qWarning() << "Could not replace binary CFG file" << filename.c_str();
+        return false;
+    }
+    return true;
+}
+
+BinaryCFGFile::~BinaryCFGFile() = default;
+
+std::shared_ptr<const BinaryCFGFile> BinaryCFGFile::open(const std::string& filename,
+                                                         std::string* error) {
+    auto fail = [&](const std::string& reason) -> std::shared_ptr<const BinaryCFGFile> {
+        qWarning() << "Cannot load binary CFG file" << filename.c_str() << ":" << reason.c_str();
+        if (error) *error = reason;
+        return nullptr;
+    };
+
+    std::shared_ptr<BinaryCFGFile> file(new BinaryCFGFile());
+    file->m_file = std::make_unique<QFile>(QString::fromStdString(filename));
+    if (!file->m_file->open(QIODevice::ReadOnly)) {
+        return fail(file->m_file->errorString().toStdString());
+    }
+
+    const qint64 size = file->m_file->size();
+    if (size < static_cast<qint64>(sizeof(BinaryCFG::Header))) {
+        return fail("file is too small");
+    }
+    // The mapping lives as long as the QFile, i.e. as long as this object
+    const uchar* data = file->m_file->map(0, size);
+    if (!data) {
+        return fail("could not map file: " + file->m_file->errorString().toStdString());
+    }
+
+    const auto* header = reinterpret_cast<const BinaryCFG::Header*>(data);
+    if (std::memcmp(header->magic, BinaryCFG::Magic, sizeof(header->magic)) != 0) {
+        return fail("not a binary CFG file");
+    }
+    if (header->byteOrder != BinaryCFG::ByteOrderMark) {
+        return fail("written on a machine with another byte order");
+    }
+    if (header->version != BinaryCFG::Version) {
+        return fail("unsupported version " + std::to_string(header->version));
+    }
+    if (header->nodeCount > MaxCount || header->edgeCount > MaxCount ||
+        header->statementCount > MaxCount || header->stringBytes > MaxCount) {
+        return fail("corrupt header");
+    }
+
+    const uint64_t expectedSize = sizeof(BinaryCFG::Header) +
+        header->functionCount * uint64_t(sizeof(BinaryCFG::FunctionRecord)) +
+        header->nodeCount * sizeof(BinaryCFG::NodeRecord) +
+        header->edgeCount * sizeof(BinaryCFG::EdgeRecord) +
+        header->statementCount * sizeof(BinaryCFG::TextRef) +
+        header->stringBytes;
+    if (expectedSize != static_cast<uint64_t>(size)) {
+        return fail("file is truncated or corrupt");
+    }
+
+    const char* payload = reinterpret_cast<const char*>(data) + sizeof(BinaryCFG::Header);
+    if (llvm::xxHash64(llvm::StringRef(payload, size - sizeof(BinaryCFG::Header))) !=
+        header->checksum) {
+        return fail("checksum mismatch");
+    }
+
+    const char* cursor = payload;
+    file->m_header = header;
+    file->m_functions = reinterpret_cast<const BinaryCFG::FunctionRecord*>(cursor);
+    cursor += header->functionCount * sizeof(BinaryCFG::FunctionRecord);
+    file->m_nodes = reinterpret_cast<const BinaryCFG::NodeRecord*>(cursor);
+    cursor += header->nodeCount * sizeof(BinaryCFG::NodeRecord);
+    file->m_edges = reinterpret_cast<const BinaryCFG::EdgeRecord*>(cursor);
+    cursor += header->edgeCount * sizeof(BinaryCFG::EdgeRecord);
+    file->m_statements = reinterpret_cast<const BinaryCFG::TextRef*>(cursor);
+    cursor += header->statementCount * sizeof(BinaryCFG::TextRef);
+    file->m_strings = cursor;
+
+    // Only the function table is checked up front; node records are checked when read
+    for (size_t i = 0; i < header->functionCount; ++i) {
+        const BinaryCFG::FunctionRecord& function = file->m_functions[i];
+        if (uint64_t(function.firstNode) + function.nodeCount > header->nodeCount) {
+            return fail("function record out of range");
+        }
+    }
+
+    return file;
+}
+
+int BinaryCFGFile::findFunction(std::string_view name) const {
+    size_t first = 0;
+    size_t count = functionCount();
+    while (count > 0) {
+        size_t step = count / 2;
+        if (functionName(first + step) < name) {
+            first += step + 1;
+            count -= step + 1;
+        } else {
+            count = step;
+        }
+    }
+    return first < functionCount() && functionName(first) == name ? static_cast<int>(first) : -1;
+}
+
+std::string_view BinaryCFGFile::text(const BinaryCFG::TextRef& ref) const {
+    if (uint64_t(ref.offset) + ref.length > m_header->stringBytes) return {};
+    return std::string_view(m_strings + ref.offset, ref.length);
+}
+
+std::string_view BinaryCFGFile::statement(uint32_t index) const {
+    if (index >= m_header->statementCount) return {};
+    return text(m_statements[index]);
+}
+
+std::unique_ptr<CFGGraph> BinaryCFGFile::toGraph(size_t function) const {
+    if (function >= functionCount()) return nullptr;
+
+    auto graph = std::make_unique<CFGGraph>();
+    const BinaryCFG::FunctionRecord& record = m_functions[function];
+    for (uint32_t i = 0; i < record.nodeCount; ++i) {
+        const BinaryCFG::NodeRecord& node = m_nodes[record.firstNode + i];
+        if (node.id < 0) continue;
+
+        graph->addNode(node.id, std::string(text(node.label)));
+        if (node.line) graph->setNodeLine(node.id, node.line);
+        if (node.flags & CFGGraph::TryBlockNode) graph->markNodeAsTryBlock(node.id);
+        if (node.flags & CFGGraph::ThrowingNode) graph->markNodeAsThrowingException(node.id);
+
+        if (uint64_t(node.firstStatement) + node.statementCount <= m_header->statementCount) {
+            for (uint32_t s = 0; s < node.statementCount; ++s) {
+                graph->addStatementToNode(node.id, statement(node.firstStatement + s));
+            }
+        }
+        if (uint64_t(node.firstEdge) + node.edgeCount <= m_header->edgeCount) {
+            for (uint32_t e = 0; e < node.edgeCount; ++e) {
+                const BinaryCFG::EdgeRecord& edge = m_edges[node.firstEdge + e];
+                if (edge.target >= 0) {
+                    graph->addEdge(node.id, edge.target, static_cast<uint8_t>(edge.flags));
+                }
+            }
+        }
+    }
+    graph->finalize();
+    return graph;
+}
+
+} // namespace GraphGenerator
@@ -0,0 +1,288 @@
+#include "cfg_bundle.h"
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/xxhash.h>
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <tuple>
+#include <QByteArray>
+#include <QDebug>
+#include <QFile>
+
+namespace GraphGenerator {
+
+namespace {
+
+    constexpr uint64_t MaxText = std::numeric_limits<uint32_t>::max();
+
+    // Index records are read in place, so the index starts on an 8-byte boundary
+    uint64_t paddingFor(uint64_t offset) {
+        return (8 - offset % 8) % 8;
+    }
+
+    BinaryCFG::TextRef addText(std::string& strings, std::string_view text) {
+        BinaryCFG::TextRef ref{static_cast<uint32_t>(strings.size()), static_cast<uint32_t>(text.size())};
+        strings.append(text.data(), text.size());
+        return ref;
+    }
+
+} // namespace
+
+BundleWriter::BundleWriter(const std::string& filename, bool compressEntries)
+    : m_filename(filename), m_spoolPath(filename + ".spool.tmp"), m_tempPath(filename + ".tmp"),
+      m_compressEntries(compressEntries) {
+    m_out.open(m_spoolPath, std::ios::binary | std::ios::trunc);
+    if (!m_out.is_open()) {
+        qWarning() << "Could not write bundle" << filename.c_str();
+        m_failed = true;
+    }
+}
+
+BundleWriter::~BundleWriter() {
+    if (!m_finished) {
+        m_out.close();
+        llvm::sys::fs::remove(m_spoolPath);
+        llvm::sys::fs::remove(m_tempPath);
+    }
+}
+
+bool BundleWriter::add(std::string_view name, std::string_view usr, Bundle::EntryKind kind,
+                       std::string_view content, bool compress) {
+    if (!isOpen() || m_finished) return false;
+    if (name.size() > MaxText || usr.size() > MaxText) return false;
+
+    std::string key = std::to_string(static_cast<uint32_t>(kind)) + '|' +
+                      std::string(usr.empty() ? name : usr);
+    if (!m_keys.insert(std::move(key)).second) return true;
+
+    Pending entry{std::string(name), std::string(usr), Bundle::IndexRecord{}};
+    Bundle::IndexRecord& record = entry.record;
+    record.offset = m_offset;
+    record.length = content.size();
+    record.hash = llvm::xxHash64(llvm::StringRef(content.data(), content.size()));
+    record.kind = static_cast<uint32_t>(kind);
+
+    if (compress && content.size() <= static_cast<size_t>(std::numeric_limits<int>::max())) {
+        QByteArray packed = qCompress(reinterpret_cast<const uchar*>(content.data()),
+                                      static_cast<int>(content.size()));
+        record.flags |= Bundle::CompressedEntry;
+        record.storedLength = static_cast<uint64_t>(packed.size());
+        m_out.write(packed.constData(), packed.size());
+    } else {
+        record.storedLength = content.size();
+        m_out.write(content.data(), static_cast<std::streamsize>(content.size()));
+    }
+    if (!m_out) {
+        qWarning() << "Could not write bundle" << m_filename.c_str();
+        m_failed = true;
+        return false;
+    }
+
+    m_offset += record.storedLength;
+    m_entries.push_back(std::move(entry));
+    return true;
+}
+
+bool BundleWriter::finish() {
+    if (!isOpen() || m_finished) return false;
+
+    std::sort(m_entries.begin(), m_entries.end(), [](const Pending& a, const Pending& b) {
+        return std::tie(a.name, a.record.kind, a.usr) < std::tie(b.name, b.record.kind, b.usr);
+    });
+
+    m_out.close();
+    std::ifstream spool(m_spoolPath, std::ios::binary);
+    std::ofstream out(m_tempPath, std::ios::binary | std::ios::trunc);
+    if (!m_out || !spool.is_open() || !out.is_open()) {
+        qWarning() << "Could not write bundle" << m_filename.c_str();
+        m_failed = true;
+        return false;
+    }
+
+    Bundle::Header header{};
+    std::memcpy(header.magic, Bundle::Magic, sizeof(header.magic));
+    header.version = Bundle::Version;
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    uint64_t offset = sizeof(header);
+
+    std::string strings;
+    std::string blob;
+    std::vector<Bundle::IndexRecord> index;
+    index.reserve(m_entries.size());
+    for (Pending& entry : m_entries) {
+        if (strings.size() + entry.name.size() + entry.usr.size() > MaxText) {
+            qWarning() << "Bundle index too large:" << m_filename.c_str();
+            m_failed = true;
+            return false;
+        }
+        blob.resize(entry.record.storedLength);
+        spool.seekg(static_cast<std::streamoff>(entry.record.offset));
+        spool.read(blob.data(), static_cast<std::streamsize>(blob.size()));
+        out.write(blob.data(), static_cast<std::streamsize>(blob.size()));
+
+        entry.record.offset = offset;
+        entry.record.name = addText(strings, entry.name);
+        entry.record.usr = addText(strings, entry.usr);
+        index.push_back(entry.record);
+        offset += entry.record.storedLength;
+    }
+    strings.append(paddingFor(strings.size()), '\0');
+    spool.close();
+    llvm::sys::fs::remove(m_spoolPath);
+
+    static const char zeros[8] = {};
+    uint64_t padding = paddingFor(offset);
+    out.write(zeros, static_cast<std::streamsize>(padding));
+
+    Bundle::Trailer trailer{};
+    trailer.indexOffset = offset + padding;
+    trailer.entryCount = index.size();
+    trailer.stringBytes = strings.size();
+    trailer.byteOrder = Bundle::ByteOrderMark;
+    std::memcpy(trailer.magic, Bundle::Magic, sizeof(trailer.magic));
+
+    std::string tail(reinterpret_cast<const char*>(index.data()), index.size() * sizeof(Bundle::IndexRecord));
+    tail += strings;
+    trailer.checksum = llvm::xxHash64(llvm::StringRef(tail.data(), tail.size()));
+    tail.append(reinterpret_cast<const char*>(&trailer), sizeof(trailer));
+    out.write(tail.data(), static_cast<std::streamsize>(tail.size()));
+    out.close();
+    if (!spool || !out) {
+        qWarning() << "Could not write bundle" << m_filename.c_str();
+        m_failed = true;
+        return false;
+    }
+
+    if (llvm::sys::fs::rename(m_tempPath, m_filename)) {
+        qWarning() << "Could not replace bundle" << m_filename.c_str();
+        m_failed = true;
+        return false;
+    }
+    m_finished = true;
+    return true;
+}
+
+BundleFile::~BundleFile() = default;
+
+std::shared_ptr<const BundleFile> BundleFile::open(const std::string& filename, std::string* error) {
+    auto fail = [&](const std::string& reason) -> std::shared_ptr<const BundleFile> {
+        qWarning() << "Cannot load bundle" << filename.c_str() << ":" << reason.c_str();
+        if (error) *error = reason;
+        return nullptr;
+    };
+
+    std::shared_ptr<BundleFile> file(new BundleFile());
+    file->m_file = std::make_unique<QFile>(QString::fromStdString(filename));
+    if (!file->m_file->open(QIODevice::ReadOnly)) {
+        return fail(file->m_file->errorString().toStdString());
+    }
+
+    const uint64_t size = static_cast<uint64_t>(file->m_file->size());
+    if (size < sizeof(Bundle::Header) + sizeof(Bundle::Trailer)) {
+        return fail("file is too small");
+    }
+    // The mapping lives as long as the QFile, i.e. as long as this object
+    const uchar* data = file->m_file->map(0, static_cast<qint64>(size));
+    if (!data) {
+        return fail("could not map file: " + file->m_file->errorString().toStdString());
+    }
+    file->m_data = reinterpret_cast<const char*>(data);
+
+    const auto* header = reinterpret_cast<const Bundle::Header*>(data);
+    const auto* trailer = reinterpret_cast<const Bundle::Trailer*>(
+        file->m_data + size - sizeof(Bundle::Trailer));
+    if (std::memcmp(header->magic, Bundle::Magic, sizeof(header->magic)) != 0 ||
+        std::memcmp(trailer->magic, Bundle::Magic, sizeof(trailer->magic)) != 0) {
+        return fail("not a CFG bundle, or not completely written");
+    }
+    if (trailer->byteOrder != Bundle::ByteOrderMark) {
+        return fail("written on a machine with another byte order");
+    }
+    if (header->version != Bundle::Version) {
+        return fail("unsupported version " + std::to_string(header->version));
+    }
+
+    const uint64_t indexEnd = size - sizeof(Bundle::Trailer);
+    if (trailer->indexOffset < sizeof(Bundle::Header) || trailer->indexOffset % 8 != 0 ||
+        trailer->indexOffset > indexEnd || trailer->stringBytes > MaxText ||
+        trailer->entryCount > (indexEnd - trailer->indexOffset) / sizeof(Bundle::IndexRecord) ||
+        trailer->indexOffset + trailer->entryCount * sizeof(Bundle::IndexRecord) +
+            trailer->stringBytes != indexEnd) {
+        return fail("corrupt index");
+    }
+    const char* index = file->m_data + trailer->indexOffset;
+    if (llvm::xxHash64(llvm::StringRef(index, indexEnd - trailer->indexOffset)) != trailer->checksum) {
+        return fail("index checksum mismatch");
+    }
+
+    file->m_trailer = trailer;
+    file->m_index = reinterpret_cast<const Bundle::IndexRecord*>(index);
+    file->m_strings = index + trailer->entryCount * sizeof(Bundle::IndexRecord);
+
+    for (size_t i = 0; i < trailer->entryCount; ++i) {
+        const Bundle::IndexRecord& record = file->m_index[i];
+        if (record.offset < sizeof(Bundle::Header) || record.offset > trailer->indexOffset ||
+            record.storedLength > trailer->indexOffset - record.offset) {
+            return fail("entry out of range");
+        }
+    }
+    return file;
+}
+
+std::string_view BundleFile::text(const BinaryCFG::TextRef& ref) const {
+    if (uint64_t(ref.offset) + ref.length > m_trailer->stringBytes) return {};
+    return std::string_view(m_strings + ref.offset, ref.length);
+}
+
+int BundleFile::find(std::string_view name, Bundle::EntryKind kind) const {
+    const uint32_t wanted = static_cast<uint32_t>(kind);
+    size_t first = 0;
+    size_t count = entryCount();
+    while (count > 0) {
+        size_t step = count / 2;
+        size_t i = first + step;
+        if (std::make_pair(this->name(i), m_index[i].kind) < std::make_pair(name, wanted)) {
+            first = i + 1;
+            count -= step + 1;
+        } else {
+            count = step;
+        }
+    }
+    return first < entryCount() && this->name(first) == name && m_index[first].kind == wanted
+        ? static_cast<int>(first) : -1;
+}
+
+int BundleFile::findByUsr(std::string_view usr, Bundle::EntryKind kind) const {
+    for (size_t i = 0; i < entryCount(); ++i) {
+        if (m_index[i].kind == static_cast<uint32_t>(kind) && this->usr(i) == usr) {
+            return static_cast<int>(i);
+        }
+    }
+    return -1;
+}
+
+bool BundleFile::read(size_t index, std::string& content) const {
+    content.clear();
+    if (index >= entryCount()) return false;
+
+    const Bundle::IndexRecord& record = m_index[index];
+    const char* stored = m_data + record.offset;
+    if (record.flags & Bundle::CompressedEntry) {
+        if (record.storedLength > static_cast<uint64_t>(std::numeric_limits<int>::max())) return false;
+        QByteArray inflated = qUncompress(reinterpret_cast<const uchar*>(stored),
+                                          static_cast<int>(record.storedLength));
+        content.assign(inflated.constData(), static_cast<size_t>(inflated.size()));
+    } else {
+        content.assign(stored, record.storedLength);
+    }
+
+    if (content.size() != record.length ||
+        llvm::xxHash64(llvm::StringRef(content.data(), content.size())) != record.hash) {
+        qWarning() << "Bundle entry" << index << "is corrupt";
+        content.clear();
+        return false;
+    }
+    return true;
+}
+
+} // namespace GraphGenerator
@@ -1,5 +1,5 @@
 #include "cfg_generation_action.h"
-#include "cfg_generation_action.h"
+#include "analysis_scope.h"
 #include <clang/ASTMatchers/ASTMatchers.h>
 #include <clang/ASTMatchers/ASTMatchFinder.h>
 #include <clang/Frontend/CompilerInstance.h>
@@ -10,18 +10,26 @@ CFGGenerationConsumer::CFGGenerationConsumer(std::vector<std::unique_ptr<GraphGe
 void CFGGenerationConsumer::HandleTranslationUnit(clang::ASTContext& Context) {
     using namespace clang::ast_matchers;
 
-    // Match all function declarations
-    auto matcher = functionDecl().bind("function");
+    // Match function definitions; the scope then drops library and third-party code
+    AnalysisScope scope = AnalysisScope::current();
+    auto matcher = scope.includeSystemHeaders
+        ? functionDecl(isDefinition()).bind("function")
+        : functionDecl(isDefinition(), unless(isExpansionInSystemHeader())).bind("function");
     
     struct MatchHandler : public MatchFinder::MatchCallback {
         std::vector<std::unique_ptr<GraphGenerator::CFGGraph>>& graphs;
+        AnalysisScope::Filter filter;
+        std::shared_ptr<GraphGenerator::StatementPool> statements;
         
-        explicit MatchHandler(std::vector<std::unique_ptr<GraphGenerator::CFGGraph>>& g) : graphs(g) {}
+        MatchHandler(std::vector<std::unique_ptr<GraphGenerator::CFGGraph>>& g,
+                     const AnalysisScope& scope, const clang::SourceManager& SM)
+            : graphs(g), filter(scope, SM) {}
 
         void run(const MatchFinder::MatchResult& Result) override {
             const auto* func = Result.Nodes.getNodeAs<clang::FunctionDecl>("function");
-            if (func && func->hasBody()) {
-                auto cfg = GraphGenerator::generateCFG(func);
+            if (func && func->hasBody() && filter.contains(func)) {
+                auto cfg = GraphGenerator::generateCFG(
+                    func, GraphGenerator::StatementPool::acquire(statements));
                 if (cfg) {
                     graphs.push_back(std::move(cfg));
                 }
@@ -29,7 +37,7 @@ void CFGGenerationConsumer::HandleTranslationUnit(clang::ASTContext& Context) {
         }
     };
 
-    MatchHandler handler(m_graphs);
+    MatchHandler handler(m_graphs, scope, Context.getSourceManager());
     MatchFinder finder;
     finder.addMatcher(matcher, &handler);
     finder.matchAST(Context);
@@ -1,65 +1,435 @@
 #include "graph_generator.h"
+#include "dot_writer.h"
+#include <llvm/Support/xxhash.h>
+#include <algorithm>
 #include <fstream>
+#include <numeric>
 #include <sstream>
+#include <stdexcept>
 
 namespace GraphGenerator {
 
-void CFGGraph::addStatement(int nodeID, const std::string& stmt) {
+CFGGraph::CFGGraph(std::shared_ptr<StatementPool> statements)
+    : m_statements(statements ? std::move(statements) : std::make_shared<StatementPool>()) {}
+
+CFGGraph::CFGGraph(const CFGGraph& other) {
+    *this = other;
+}
+
+CFGGraph& CFGGraph::operator=(const CFGGraph& other) {
+    if (this == &other) return *this;
+    other.finalize();
+
+    std::lock_guard<std::mutex> lock(m_finalizeMutex);
+    m_statements = other.m_statements;
+    m_nodes = other.m_nodes;
+    m_nodeFlags = other.m_nodeFlags;
+    m_indexById = other.m_indexById;
+    m_sparseIndex = other.m_sparseIndex;
+    m_pendingEdges.clear();
+    m_pendingEdgeFlags.clear();
+    m_succOffsets = other.m_succOffsets;
+    m_succTargets = other.m_succTargets;
+    m_edgeFlags = other.m_edgeFlags;
+    m_predOffsets = other.m_predOffsets;
+    m_predSources = other.m_predSources;
+    m_extraExceptionEdges = other.m_extraExceptionEdges;
+    m_nodeProperties = other.m_nodeProperties;
+    m_edgeProperties = other.m_edgeProperties;
+    m_finalized.store(true, std::memory_order_release);
+    return *this;
+}
+
+void CFGGraph::ensureNode(int nodeID) {
+    if (lookupIndex(nodeID) >= 0) return;
+
+    invalidate();
+    // The dense index only grows while IDs stay within a few times the node count
+    int index = static_cast<int>(m_nodes.size());
+    size_t denseLimit = std::max(m_indexById.size(), std::max<size_t>(1024, 4 * (m_nodes.size() + 1)));
+    if (nodeID >= 0 && static_cast<size_t>(nodeID) < denseLimit) {
+        if (static_cast<size_t>(nodeID) >= m_indexById.size()) {
+            m_indexById.resize(nodeID + 1, -1);
+        }
+        m_indexById[nodeID] = index;
+    } else {
+        m_sparseIndex[nodeID] = index;
+    }
+    m_nodes.emplace_back(nodeID, "Block " + std::to_string(nodeID));
+    m_nodeFlags.push_back(0);
+    m_nodeProperties.resize(m_nodes.size());
+}
+
+int CFGGraph::lookupIndex(int nodeID) const {
+    if (nodeID >= 0 && static_cast<size_t>(nodeID) < m_indexById.size() && m_indexById[nodeID] >= 0) {
+        return m_indexById[nodeID];
+    }
+    if (m_sparseIndex.empty()) return -1;
+    auto it = m_sparseIndex.find(nodeID);
+    return it != m_sparseIndex.end() ? it->second : -1;
+}
+
+void CFGGraph::setIndex(int nodeID, int index) const {
+    auto it = m_sparseIndex.find(nodeID);
+    if (it != m_sparseIndex.end()) {
+        it->second = index;
+    } else {
+        m_indexById[nodeID] = index;
+    }
+}
+
+void CFGGraph::invalidate() {
+    if (!m_finalized.load(std::memory_order_relaxed)) return;
+
+    // Turn the CSR arrays back into builder input; rare, builders do not read midway.
+    // Edges go back in CSR order, so edge property columns still line up with them.
+    for (size_t i = 0; i < m_nodes.size(); ++i) {
+        for (uint32_t e = m_succOffsets[i]; e < m_succOffsets[i + 1]; ++e) {
+            m_pendingEdges.emplace_back(m_nodes[i].id, m_succTargets[e]);
+            if (m_edgeFlags[e]) {
+                m_pendingEdgeFlags.emplace_back(m_pendingEdges.back(), m_edgeFlags[e]);
+            }
+        }
+    }
+    for (const auto& edge : m_extraExceptionEdges) {
+        m_pendingEdgeFlags.emplace_back(edge, ExceptionEdge);
+    }
+
+    m_succOffsets.clear();
+    m_succTargets.clear();
+    m_edgeFlags.clear();
+    m_predOffsets.clear();
+    m_predSources.clear();
+    m_extraExceptionEdges.clear();
+    m_finalized.store(false, std::memory_order_relaxed);
+}
+
+void CFGGraph::finalize() const {
+    if (m_finalized.load(std::memory_order_acquire)) return;
+
+    std::lock_guard<std::mutex> lock(m_finalizeMutex);
+    if (!m_finalized.load(std::memory_order_relaxed)) {
+        buildAdjacency();
+        m_finalized.store(true, std::memory_order_release);
+    }
+}
+
+void CFGGraph::buildAdjacency() const {
+    const size_t nodeCount = m_nodes.size();
+
+    // Nodes in ID order, so getNodes() iterates like the old map did
+    auto byId = [](const CFGNode& a, const CFGNode& b) { return a.id < b.id; };
+    if (!std::is_sorted(m_nodes.begin(), m_nodes.end(), byId)) {
+        std::vector<uint32_t> order(nodeCount);
+        std::iota(order.begin(), order.end(), 0);
+        std::sort(order.begin(), order.end(),
+                  [this](uint32_t a, uint32_t b) { return m_nodes[a].id < m_nodes[b].id; });
+
+        std::vector<CFGNode> nodes;
+        std::vector<uint8_t> flags;
+        nodes.reserve(nodeCount);
+        flags.reserve(nodeCount);
+        for (uint32_t index : order) {
+            nodes.push_back(std::move(m_nodes[index]));
+            flags.push_back(m_nodeFlags[index]);
+        }
+        m_nodes = std::move(nodes);
+        m_nodeFlags = std::move(flags);
+        m_nodeProperties.permute(order);
+    }
+    for (size_t i = 0; i < nodeCount; ++i) {
+        setIndex(m_nodes[i].id, static_cast<int>(i));
+    }
+
+    // Sorted by (source, target) with nodes in ID order is exactly CSR order
+    if (m_edgeProperties.empty()) {
+        std::sort(m_pendingEdges.begin(), m_pendingEdges.end());
+        m_pendingEdges.erase(std::unique(m_pendingEdges.begin(), m_pendingEdges.end()),
+                             m_pendingEdges.end());
+    } else {
+        // Same order, but tracked so the columns follow; a duplicate keeps the values of
+        // its first occurrence, which is the already finalized edge if there was one
+        std::vector<uint32_t> order(m_pendingEdges.size());
+        std::iota(order.begin(), order.end(), 0);
+        std::stable_sort(order.begin(), order.end(), [this](uint32_t a, uint32_t b) {
+            return m_pendingEdges[a] < m_pendingEdges[b];
+        });
+        order.erase(std::unique(order.begin(), order.end(), [this](uint32_t a, uint32_t b) {
+            return m_pendingEdges[a] == m_pendingEdges[b];
+        }), order.end());
+
+        std::vector<std::pair<int, int>> edges;
+        edges.reserve(order.size());
+        for (uint32_t index : order) {
+            edges.push_back(m_pendingEdges[index]);
+        }
+        m_pendingEdges = std::move(edges);
+        m_edgeProperties.permute(order);
+    }
+    const size_t edgeCount = m_pendingEdges.size();
+
+    m_succOffsets.assign(nodeCount + 1, 0);
+    m_succTargets.resize(edgeCount);
+    m_edgeFlags.assign(edgeCount, 0);
+    for (size_t e = 0; e < edgeCount; ++e) {
+        ++m_succOffsets[lookupIndex(m_pendingEdges[e].first) + 1];
+        m_succTargets[e] = m_pendingEdges[e].second;
+    }
+    std::partial_sum(m_succOffsets.begin(), m_succOffsets.end(), m_succOffsets.begin());
+
+    // Predecessors by counting sort on the target; sources come out sorted per row
+    m_predOffsets.assign(nodeCount + 1, 0);
+    m_predSources.resize(edgeCount);
+    for (const auto& edge : m_pendingEdges) {
+        ++m_predOffsets[lookupIndex(edge.second) + 1];
+    }
+    std::partial_sum(m_predOffsets.begin(), m_predOffsets.end(), m_predOffsets.begin());
+    std::vector<uint32_t> cursor(m_predOffsets.begin(), m_predOffsets.end() - 1);
+    for (const auto& edge : m_pendingEdges) {
+        m_predSources[cursor[lookupIndex(edge.second)]++] = edge.first;
+    }
+
+    // Flags land on their edge. Exception edges that are not also successor edges are
+    // kept aside so isExceptionEdge still knows them; other stray flags are dropped.
+    std::sort(m_pendingEdgeFlags.begin(), m_pendingEdgeFlags.end());
+    m_extraExceptionEdges.clear();
+    for (const auto& [edge, flags] : m_pendingEdgeFlags) {
+        int source = lookupIndex(edge.first);
+        if (source >= 0) {
+            const int* first = m_succTargets.data() + m_succOffsets[source];
+            const int* last = m_succTargets.data() + m_succOffsets[source + 1];
+            const int* it = std::lower_bound(first, last, edge.second);
+            if (it != last && *it == edge.second) {
+                m_edgeFlags[it - m_succTargets.data()] |= flags;
+                continue;
+            }
+        }
+        if ((flags & ExceptionEdge) &&
+            (m_extraExceptionEdges.empty() || m_extraExceptionEdges.back() != edge)) {
+            m_extraExceptionEdges.push_back(edge);
+        }
+    }
+
+    std::vector<std::pair<int, int>>().swap(m_pendingEdges);
+    std::vector<std::pair<std::pair<int, int>, uint8_t>>().swap(m_pendingEdgeFlags);
+}
+
+void CFGGraph::addNode(int nodeID) {
+    ensureNode(nodeID);
+}
+
+void CFGGraph::addNode(int id, const std::string& label) {
+    ensureNode(id);
+    m_nodes[lookupIndex(id)].label = label;
+}
+
+void CFGGraph::addStatementToNode(int nodeID, std::string_view stmt) {
+    ensureNode(nodeID);
+    m_nodes[lookupIndex(nodeID)].statements.push_back(m_statements->intern(stmt));
+}
+
+void CFGGraph::addStatementHandle(int nodeID, StatementPool::Handle stmt) {
+    ensureNode(nodeID);
+    m_nodes[lookupIndex(nodeID)].statements.push_back(stmt);
+}
+
+void CFGGraph::addStatement(int nodeID, std::string_view stmt) {
     addStatementToNode(nodeID, stmt);
 }
 
+void CFGGraph::addEdge(int fromID, int toID, uint8_t flags) {
+    ensureNode(fromID);
+    ensureNode(toID);
+    invalidate();
+    m_pendingEdges.emplace_back(fromID, toID);
+    if (flags) {
+        m_pendingEdgeFlags.emplace_back(std::make_pair(fromID, toID), flags);
+    }
+}
+
 void CFGGraph::addExceptionEdge(int sourceID, int targetID) {
-    exceptionEdges.insert({sourceID, targetID});
+    invalidate();
+    m_pendingEdgeFlags.emplace_back(std::make_pair(sourceID, targetID), ExceptionEdge);
+}
+
+uint8_t CFGGraph::getEdgeFlags(int sourceID, int targetID) const {
+    int edge = edgeIndex(sourceID, targetID);
+    return edge >= 0 ? m_edgeFlags[edge] : 0;
+}
+
+void CFGGraph::setNodeLine(int nodeID, unsigned line) {
+    ensureNode(nodeID);
+    m_nodes[lookupIndex(nodeID)].line = line;
+}
+
+unsigned CFGGraph::getNodeLine(int nodeID) const {
+    int index = indexOf(nodeID);
+    return index >= 0 ? m_nodes[index].line : 0;
 }
 
 bool CFGGraph::isExceptionEdge(int sourceID, int targetID) const {
-    return exceptionEdges.count({sourceID, targetID}) > 0;
+    return hasEdgeFlag(sourceID, targetID, ExceptionEdge) ||
+           std::binary_search(m_extraExceptionEdges.begin(), m_extraExceptionEdges.end(),
+                              std::make_pair(sourceID, targetID));
+}
+
+bool CFGGraph::hasEdgeFlag(int sourceID, int targetID, uint8_t flag) const {
+    return (getEdgeFlags(sourceID, targetID) & flag) != 0;
 }
 
 void CFGGraph::markNodeAsTryBlock(int nodeID) {
-    tryBlocks.insert(nodeID);
+    ensureNode(nodeID);
+    m_nodeFlags[lookupIndex(nodeID)] |= TryBlockNode;
 }
 
 void CFGGraph::markNodeAsThrowingException(int nodeID) {
-    throwingBlocks.insert(nodeID);
+    ensureNode(nodeID);
+    m_nodeFlags[lookupIndex(nodeID)] |= ThrowingNode;
 }
 
 bool CFGGraph::isNodeTryBlock(int nodeID) const {
-    return tryBlocks.count(nodeID) > 0;
+    int index = indexOf(nodeID);
+    return index >= 0 && (m_nodeFlags[index] & TryBlockNode);
 }
 
 bool CFGGraph::isNodeThrowingException(int nodeID) const {
-    return throwingBlocks.count(nodeID) > 0;
+    int index = indexOf(nodeID);
+    return index >= 0 && (m_nodeFlags[index] & ThrowingNode);
 }
 
 std::string CFGGraph::getNodeLabel(int nodeID) const {
-    auto it = nodes.find(nodeID);
-    if (it != nodes.end()) {
-        return it->second.label.empty() ? 
+    int index = indexOf(nodeID);
+    if (index >= 0) {
+        const CFGNode& node = m_nodes[index];
+        return node.label.empty() ? 
             "Block " + std::to_string(nodeID) : 
-            it->second.label;
+            node.label;
     }
     return "Unknown Block";
 }
 
-void CFGGraph::addNode(int id, const std::string& label) {
-    if (nodes.find(id) == nodes.end()) {
-        nodes[id] = CFGNode(id, label);
-    } else {
-        nodes[id].label = label;
+size_t CFGGraph::getNodeCount() const { 
+    return m_nodes.size(); 
+}
+
+size_t CFGGraph::getEdgeCount() const {
+    finalize();
+    return m_succTargets.size();
+}
+
+std::vector<std::string> CFGGraph::getFunctionNames() const {
+    finalize();
+    std::vector<std::string> names;
+    for (const CFGNode& node : m_nodes) {
+        if (!node.functionName.empty()) {
+            names.push_back(node.functionName);
+        }
     }
+    return names;
 }
 
-size_t CFGGraph::getNodeCount() const { 
-    return nodes.size(); 
+bool CFGGraph::hasNode(int nodeID) const {
+    return indexOf(nodeID) >= 0;
 }
 
-size_t CFGGraph::getEdgeCount() const {
-    size_t count = 0;
-    for (const auto& [id, node] : nodes) {
-        count += node.successors.size();
+int CFGGraph::indexOf(int nodeID) const {
+    finalize();
+    return lookupIndex(nodeID);
+}
+
+CFGGraph::AdjacencyRange CFGGraph::successors(int nodeID) const {
+    int index = indexOf(nodeID);
+    if (index < 0) return AdjacencyRange();
+    return AdjacencyRange(m_succTargets.data() + m_succOffsets[index],
+                          m_succTargets.data() + m_succOffsets[index + 1]);
+}
+
+CFGGraph::AdjacencyRange CFGGraph::predecessors(int nodeID) const {
+    int index = indexOf(nodeID);
+    if (index < 0) return AdjacencyRange();
+    return AdjacencyRange(m_predSources.data() + m_predOffsets[index],
+                          m_predSources.data() + m_predOffsets[index + 1]);
+}
+
+int CFGGraph::edgeIndex(int sourceID, int targetID) const {
+    int index = indexOf(sourceID);
+    if (index < 0) return -1;
+
+    const int* first = m_succTargets.data() + m_succOffsets[index];
+    const int* last = m_succTargets.data() + m_succOffsets[index + 1];
+    const int* it = std::lower_bound(first, last, targetID);
+    return it != last && *it == targetID ? static_cast<int>(it - m_succTargets.data()) : -1;
+}
+
+size_t CFGGraph::edgeOffset(size_t index) const {
+    finalize();
+    return m_succOffsets[index];
+}
+
+bool CFGGraph::removeNodeProperty(const std::string& name) {
+    finalize();
+    return m_nodeProperties.remove(name);
+}
+
+bool CFGGraph::removeEdgeProperty(const std::string& name) {
+    finalize();
+    return m_edgeProperties.remove(name);
+}
+
+CFGGraph::NodeView CFGGraph::nodeView(size_t index) const {
+    finalize();
+    const CFGNode& node = m_nodes[index];
+    return NodeView{
+        node.id,
+        node.label,
+        node.functionName,
+        node.line,
+        StatementRange(m_statements.get(), node.statements),
+        AdjacencyRange(m_succTargets.data() + m_succOffsets[index],
+                       m_succTargets.data() + m_succOffsets[index + 1]),
+        AdjacencyRange(m_predSources.data() + m_predOffsets[index],
+                       m_predSources.data() + m_predOffsets[index + 1])
+    };
+}
+
+uint64_t CFGGraph::contentHash() const {
+    finalize();
+
+    // Fields are length-prefixed, so different graphs cannot run together into one text
+    std::string buffer;
+    auto put = [&buffer](const void* data, size_t size) {
+        buffer.append(static_cast<const char*>(data), size);
+    };
+    auto putCount = [&put](uint64_t count) { put(&count, sizeof(count)); };
+    auto putText = [&](std::string_view text) {
+        putCount(text.size());
+        put(text.data(), text.size());
+    };
+
+    putCount(m_nodes.size());
+    for (size_t i = 0; i < m_nodes.size(); ++i) {
+        const CFGNode& node = m_nodes[i];
+        put(&node.id, sizeof(node.id));
+        put(&node.line, sizeof(node.line));
+        put(&m_nodeFlags[i], sizeof(m_nodeFlags[i]));
+        putText(node.label);
+        putText(node.functionName);
+        putCount(node.statements.size());
+        for (StatementPool::Handle statement : node.statements) {
+            putText(m_statements->get(statement));
+        }
+        putCount(m_succOffsets[i + 1] - m_succOffsets[i]);
+        for (uint32_t edge = m_succOffsets[i]; edge < m_succOffsets[i + 1]; ++edge) {
+            put(&m_succTargets[edge], sizeof(m_succTargets[edge]));
+            put(&m_edgeFlags[edge], sizeof(m_edgeFlags[edge]));
+        }
+    }
+    putCount(m_extraExceptionEdges.size());
+    for (const auto& [source, target] : m_extraExceptionEdges) {
+        put(&source, sizeof(source));
+        put(&target, sizeof(target));
     }
-    return count;
+    return llvm::xxHash64(llvm::StringRef(buffer.data(), buffer.size()));
 }
 
 void CFGGraph::writeToDotFile(const std::string& filename) const {
@@ -68,78 +438,101 @@ void CFGGraph::writeToDotFile(const std::string& filename) const {
         throw std::runtime_error("Could not open dot file for writing");
     }
 
-    dotFile << "digraph CFG {\n";
+    DotWriter writer(dotFile);
+    writer.beginGraph("CFG");
     
     // Write nodes with special formatting for try and throw blocks
-    for (const auto& [nodeID, node] : nodes) {
-        dotFile << "    " << nodeID << " [label=\"" << getNodeLabel(nodeID) << "\"";
+    for (const auto& [nodeID, node] : getNodes()) {
+        writer.raw("  ").number(nodeID).raw(" [label=\"");
+        if (node.label.empty()) {
+            writer.raw("Block ").number(nodeID);
+        } else {
+            writer.escaped(node.label);
+        }
+        writer.raw('"');
         
         if (isNodeTryBlock(nodeID)) {
-            dotFile << " shape=box color=lightblue";
+            writer.raw(" shape=box color=lightblue");
         }
         else if (isNodeThrowingException(nodeID)) {
-            dotFile << " color=red";
+            writer.raw(" color=red");
         }
         
-        dotFile << "];\n";
+        writer.raw("];\n");
     }
 
     // Write edges with special formatting for exception edges
-    for (const auto& [nodeID, node] : nodes) {
+    for (const auto& [nodeID, node] : getNodes()) {
         for (int successorID : node.successors) {
-            dotFile << "    " << nodeID << " -> " << successorID;
+            writer.edge(nodeID, successorID);
             
             if (isExceptionEdge(nodeID, successorID)) {
-                dotFile << " [color=red]";
+                writer.raw(" [color=red]");
             }
             
-            dotFile << ";\n";
+            writer.raw(";\n");
         }
     }
 
-    dotFile << "}\n";
-    dotFile.close();
+    writer.endGraph();
+    if (!writer.flush()) {
+        throw std::runtime_error("Could not write dot file");
+    }
 }
 
 void CFGGraph::writeToJsonFile(const std::string& filename, 
                              const json& astJson, 
-                             const json& functionCallJson) {
-    json graphJson;
-    
-    // Add nodes with all properties
-    for (const auto& [nodeID, node] : nodes) {
-        graphJson["nodes"][std::to_string(nodeID)] = {
-            {"id", nodeID},
-            {"label", getNodeLabel(nodeID)},
-            {"functionName", node.functionName},
-            {"statements", node.statements},
-            {"isTryBlock", isNodeTryBlock(nodeID)},
-            {"isThrowingException", isNodeThrowingException(nodeID)}
-        };
-    }
-
-    // Add edges with properties
-    for (const auto& [nodeID, node] : nodes) {
-        for (int successorID : node.successors) {
-            graphJson["edges"].push_back({
-                {"source", nodeID},
-                {"target", successorID},
-                {"isExceptionEdge", isExceptionEdge(nodeID, successorID)}
-            });
-        }
+                             const json& functionCallJson,
+                             JsonWriter::Style style) const {
+    std::ofstream jsonFile(filename, std::ios::binary);
+    if (!jsonFile.is_open()) {
+        throw std::runtime_error("Could not open JSON file for writing");
     }
 
-    // Combine with additional JSON data
-    graphJson["ast"] = astJson;
-    graphJson["functionCalls"] = functionCallJson;
+    // Same document as before ("nodes" keyed by ID, "edges", "ast", "functionCalls"),
+    // written node by node instead of built as a tree first
+    JsonWriter writer(jsonFile, style, 4);
+    writer.beginObject();
 
-    std::ofstream jsonFile(filename);
-    if (!jsonFile.is_open()) {
-        throw std::runtime_error("Could not open JSON file for writing");
+    if (getNodeCount() > 0) {
+        writer.key("nodes").beginObject();
+        for (const auto& [nodeID, node] : getNodes()) {
+            writer.key(std::to_string(nodeID)).beginObject()
+                .member("id", nodeID)
+                .member("label", getNodeLabel(nodeID))
+                .member("functionName", node.functionName)
+                .key("statements").beginArray();
+            for (std::string_view stmt : node.statements) {
+                writer.value(stmt);
+            }
+            writer.endArray()
+                .member("isTryBlock", isNodeTryBlock(nodeID))
+                .member("isThrowingException", isNodeThrowingException(nodeID))
+                .endObject();
+        }
+        writer.endObject();
     }
 
-    jsonFile << graphJson.dump(4);
-    jsonFile.close();
+    if (getEdgeCount() > 0) {
+        writer.key("edges").beginArray();
+        for (const auto& [nodeID, node] : getNodes()) {
+            for (int successorID : node.successors) {
+                writer.beginObject()
+                    .member("source", nodeID)
+                    .member("target", successorID)
+                    .member("isExceptionEdge", isExceptionEdge(nodeID, successorID))
+                    .endObject();
+            }
+        }
+        writer.endArray();
+    }
+
+    writer.member("ast", astJson)
+        .member("functionCalls", functionCallJson)
+        .endObject();
+    if (!writer.flush()) {
+        throw std::runtime_error("Could not write JSON file");
+    }
 }
 
 } // namespace GraphGenerator
\ No newline at end of file
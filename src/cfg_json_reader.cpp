@@ -0,0 +1,227 @@
+#include "cfg_json_reader.h"
+#include "graph_generator.h"
+#include <nlohmann/json.hpp>
+#include <algorithm>
+#include <charconv>
+#include <climits>
+#include <vector>
+#include <QDebug>
+#include <QFile>
+
+namespace GraphGenerator {
+
+namespace {
+
+    using json = nlohmann::json;
+
+    bool parseId(std::string_view text, int& id) {
+        const char* end = text.data() + text.size();
+        auto result = std::from_chars(text.data(), end, id);
+        return !text.empty() && result.ec == std::errc() && result.ptr == end;
+    }
+
+    // SAX handler for nlohmann::json::sax_parse. Depth 1 is the document object, depth 2
+    // the "nodes"/"edges" container and depth 3 one node or edge; a node's statements are
+    // the strings at depth 4. Values anywhere else are ignored as they stream past.
+    class CFGJsonHandler {
+    public:
+        CFGJsonHandler(CFGGraph& graph, int idOffset) : m_graph(graph), m_idOffset(idOffset) {}
+
+        bool null() { return true; }
+        bool boolean(bool value) {
+            if (m_depth != 3) return true;
+            switch (m_field) {
+            case Field::TryBlock: m_tryBlock = value; break;
+            case Field::Throwing: m_throwing = value; break;
+            case Field::ExceptionEdge: m_exceptionEdge = value; break;
+            default: break;
+            }
+            return true;
+        }
+        bool number_integer(json::number_integer_t value) { return integer(value); }
+        bool number_unsigned(json::number_unsigned_t value) {
+            // Out of int range either way, so integer() skips it
+            return integer(static_cast<long long>(std::min<json::number_unsigned_t>(value, LLONG_MAX)));
+        }
+        bool number_float(json::number_float_t, const json::string_t&) { return true; }
+        bool binary(json::binary_t&) { return true; }
+
+        bool string(json::string_t& value) {
+            if (m_depth == 4 && m_field == Field::Statements) {
+                m_statements.push_back(std::move(value));
+            } else if (m_depth == 3) {
+                int id;
+                switch (m_field) {
+                case Field::Label: m_label = std::move(value); break;
+                case Field::Id:
+                case Field::Source:
+                case Field::Target:
+                    if (parseId(value, id)) integer(id);
+                    break;
+                default: break;
+                }
+            }
+            return true;
+        }
+
+        bool start_object(std::size_t) {
+            ++m_depth;
+            if (m_depth == 3) beginElement();
+            return true;
+        }
+        bool end_object() {
+            if (m_depth == 3) endElement();
+            --m_depth;
+            return true;
+        }
+        bool start_array(std::size_t) {
+            ++m_depth;
+            return true;
+        }
+        bool end_array() {
+            --m_depth;
+            return true;
+        }
+
+        bool key(json::string_t& name) {
+            if (m_depth == 1) {
+                m_section = name == "nodes" ? Section::Nodes
+                          : name == "edges" ? Section::Edges : Section::Other;
+            } else if (m_depth == 2 && m_section == Section::Nodes) {
+                m_elementKey = std::move(name);  // "nodes" keyed by ID
+            } else if (m_depth == 3) {
+                m_field = fieldFor(name);
+            }
+            return true;
+        }
+
+        bool parse_error(std::size_t, const std::string&, const nlohmann::detail::exception& e) {
+            m_error = e.what();
+            return false;
+        }
+
+        const std::string& error() const { return m_error; }
+
+    private:
+        enum class Section { Other, Nodes, Edges };
+        enum class Field { Other, Id, Label, Statements, TryBlock, Throwing,
+                           Source, Target, ExceptionEdge };
+
+        static Field fieldFor(const std::string& name) {
+            if (name == "id") return Field::Id;
+            if (name == "label") return Field::Label;
+            if (name == "statements") return Field::Statements;
+            if (name == "isTryBlock") return Field::TryBlock;
+            if (name == "isThrowingException") return Field::Throwing;
+            if (name == "source" || name == "from") return Field::Source;
+            if (name == "target" || name == "to") return Field::Target;
+            if (name == "isExceptionEdge") return Field::ExceptionEdge;
+            return Field::Other;
+        }
+
+        bool integer(long long value) {
+            if (m_depth != 3 || value < INT_MIN || value > INT_MAX) return true;
+            switch (m_field) {
+            case Field::Id: m_id = static_cast<int>(value); m_hasId = true; break;
+            case Field::Source: m_source = static_cast<int>(value); m_hasSource = true; break;
+            case Field::Target: m_target = static_cast<int>(value); m_hasTarget = true; break;
+            default: break;
+            }
+            return true;
+        }
+
+        void beginElement() {
+            m_field = Field::Other;
+            m_id = m_source = m_target = -1;
+            m_hasId = m_hasSource = m_hasTarget = false;
+            m_label.clear();
+            m_statements.clear();
+            m_tryBlock = m_throwing = m_exceptionEdge = false;
+        }
+
+        void endElement() {
+            if (m_section == Section::Nodes) {
+                if (!m_hasId && !parseId(m_elementKey, m_id)) return;
+                int id = m_id + m_idOffset;
+                // writeToJsonFile spells out the default label; keep it implicit
+                if (!m_label.empty() && m_label != "Block " + std::to_string(m_id)) {
+                    m_graph.addNode(id, m_label);
+                } else {
+                    m_graph.addNode(id);
+                }
+                for (const std::string& statement : m_statements) {
+                    m_graph.addStatement(id, statement);
+                }
+                if (m_tryBlock) m_graph.markNodeAsTryBlock(id);
+                if (m_throwing) m_graph.markNodeAsThrowingException(id);
+            } else if (m_section == Section::Edges) {
+                if (!m_hasSource || !m_hasTarget) return;
+                m_graph.addEdge(m_source + m_idOffset, m_target + m_idOffset);
+                if (m_exceptionEdge) {
+                    m_graph.addExceptionEdge(m_source + m_idOffset, m_target + m_idOffset);
+                }
+            }
+        }
+
+        CFGGraph& m_graph;
+        int m_idOffset;
+        int m_depth = 0;
+        Section m_section = Section::Other;
+        Field m_field = Field::Other;
+        std::string m_error;
+
+        // The node or edge being read
+        std::string m_elementKey;
+        int m_id = -1;
+        int m_source = -1;
+        int m_target = -1;
+        bool m_hasId = false;
+        bool m_hasSource = false;
+        bool m_hasTarget = false;
+        std::string m_label;
+        std::vector<std::string> m_statements;
+        bool m_tryBlock = false;
+        bool m_throwing = false;
+        bool m_exceptionEdge = false;
+    };
+
+} // namespace
+
+bool readJsonCFG(std::string_view document, CFGGraph& graph, int idOffset, std::string* error) {
+    CFGJsonHandler handler(graph, idOffset);
+    bool ok = json::sax_parse(document.data(), document.data() + document.size(), &handler);
+    if (!ok && error) {
+        *error = handler.error().empty() ? "invalid JSON" : handler.error();
+    }
+    return ok;
+}
+
+bool readJsonCFGFile(const std::string& filename, CFGGraph& graph, int idOffset, std::string* error) {
+    auto fail = [&](const std::string& reason) {
+        qWarning() << "Cannot load JSON CFG file" << filename.c_str() << ":" << reason.c_str();
+        if (error) *error = reason;
+        return false;
+    };
+
+    QFile file(QString::fromStdString(filename));
+    if (!file.open(QIODevice::ReadOnly)) {
+        return fail(file.errorString().toStdString());
+    }
+    const qint64 size = file.size();
+    if (size == 0) {
+        return fail("file is empty");
+    }
+    const uchar* data = file.map(0, size);
+    if (!data) {
+        return fail("could not map file: " + file.errorString().toStdString());
+    }
+
+    std::string reason;
+    bool ok = readJsonCFG(std::string_view(reinterpret_cast<const char*>(data),
+                                           static_cast<size_t>(size)),
+                          graph, idOffset, &reason);
+    file.unmap(const_cast<uchar*>(data));
+    return ok || fail(reason);
+}
+
+} // namespace GraphGenerator
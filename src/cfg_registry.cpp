@@ -0,0 +1,140 @@
+#include "cfg_registry.h"
+#include "graph_generator.h"
+#include <clang/AST/ASTContext.h>
+#include <clang/AST/Decl.h>
+#include <clang/Basic/SourceManager.h>
+#include <clang/Index/USRGeneration.h>
+#include <clang/Lex/Lexer.h>
+#include <llvm/ADT/SmallString.h>
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/xxhash.h>
+#include <fstream>
+#include <sstream>
+#include <QDebug>
+
+std::string CFGRegistry::keyFor(const clang::FunctionDecl* FD) {
+    if (!FD) return "";
+
+    llvm::SmallString<128> usr;
+    if (clang::index::generateUSRForDecl(FD, usr)) {
+        return "";
+    }
+
+    const clang::ASTContext& context = FD->getASTContext();
+    const clang::SourceManager& SM = context.getSourceManager();
+    clang::PresumedLoc loc = SM.getPresumedLoc(SM.getExpansionLoc(FD->getLocation()));
+
+    llvm::StringRef text = clang::Lexer::getSourceText(
+        clang::CharSourceRange::getTokenRange(FD->getSourceRange()), SM, context.getLangOpts());
+
+    std::ostringstream key;
+    key << usr.str().str() << '|';
+    if (loc.isValid()) {
+        key << loc.getFilename() << ':' << loc.getLine() << ':' << loc.getColumn();
+    }
+    key << '|' << std::hex << llvm::xxHash64(text);
+    return key.str();
+}
+
+std::shared_ptr<const GraphGenerator::CFGGraph> CFGRegistry::getOrBuild(
+    const std::string& key,
+    const clang::FunctionDecl* FD,
+    std::shared_ptr<GraphGenerator::StatementPool> statements) {
+    if (key.empty()) {
+        return GraphGenerator::generateCFG(FD, std::move(statements));
+    }
+
+    std::shared_ptr<Entry> entry;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto& slot = m_entries[key];
+        if (!slot) {
+            slot = std::make_shared<Entry>();
+        }
+        entry = slot;
+    }
+
+    // Only the entry is locked while building, so other functions are not held up
+    std::lock_guard<std::mutex> lock(entry->buildMutex);
+    if (!entry->built) {
+        entry->graph = GraphGenerator::generateCFG(FD, std::move(statements));
+        entry->built = true;
+    }
+    return entry->graph;
+}
+
+size_t CFGRegistry::size() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_entries.size();
+}
+
+CFGOutputIndex& CFGOutputIndex::instance() {
+    static CFGOutputIndex index;
+    return index;
+}
+
+bool CFGOutputIndex::claimOutput(const std::string& key, const std::string& path) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (key.empty()) return true;
+
+    auto it = m_outputs.find(path);
+    if (it != m_outputs.end() && it->second.key == key &&
+        (it->second.pending || llvm::sys::fs::exists(path))) {
+        return false;
+    }
+    m_outputs[path] = Output{key, true};
+    return true;
+}
+
+void CFGOutputIndex::outputWritten(const std::string& key, const std::string& path, bool written) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_outputs.find(path);
+    if (it == m_outputs.end() || it->second.key != key || !it->second.pending) return;
+
+    if (written) {
+        it->second.pending = false;
+    } else {
+        m_outputs.erase(it);
+    }
+    m_indexDirty = true;
+}
+
+void CFGOutputIndex::setIndexFile(const std::string& path) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_indexFile = path;
+    m_indexDirty = false;
+    if (path.empty()) return;
+
+    std::ifstream index(path);
+    if (!index.is_open()) return;
+
+    std::string line;
+    while (std::getline(index, line)) {
+        size_t tab = line.find('\t');
+        if (tab == std::string::npos) continue;
+        m_outputs[line.substr(tab + 1)] = Output{line.substr(0, tab), false};
+    }
+}
+
+bool CFGOutputIndex::saveIndex() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_indexFile.empty() || !m_indexDirty) return true;
+
+    std::string tempPath = m_indexFile + ".tmp";
+    {
+        std::ofstream index(tempPath, std::ios::trunc);
+        if (!index.is_open()) {
+            qWarning() << "Could not write CFG index" << m_indexFile.c_str();
+            return false;
+        }
+        for (const auto& [path, output] : m_outputs) {
+            if (!output.pending) index << output.key << '\t' << path << '\n';
+        }
+    }
+    if (llvm::sys::fs::rename(tempPath, m_indexFile)) {
+        llvm::sys::fs::remove(tempPath);
+        return false;
+    }
+    m_indexDirty = false;
+    return true;
+}
@@ -0,0 +1,154 @@
+#include "compile_commands.h"
+#include <clang/Tooling/ArgumentsAdjusters.h>
+#include <clang/Tooling/JSONCompilationDatabase.h>
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/Path.h>
+#include <filesystem>
+
+namespace fs = std::filesystem;
+
+namespace CompileCommands {
+
+namespace {
+
+    // Clang's builtin headers (stddef.h, stdarg.h, ...) live in the resource directory.
+    // ClangTool derives it from the running executable, which is not clang for us.
+    std::string resourceDirectory() {
+        static const std::string dir = []() -> std::string {
+            if (llvm::sys::fs::exists("/usr/lib/llvm-14/lib/clang/14.0.0/include")) {
+                return "/usr/lib/llvm-14/lib/clang/14.0.0";
+            }
+            std::error_code ec;
+            if (fs::exists("/usr/lib/llvm", ec)) {
+                for (const auto& entry : fs::directory_iterator("/usr/lib/llvm", ec)) {
+                    if (entry.path().string().find("clang") != std::string::npos) {
+                        return entry.path().string();
+                    }
+                }
+            }
+            return "";
+        }();
+        return dir;
+    }
+
+    clang::tooling::ArgumentsAdjuster syntaxOnlyAdjuster() {
+        using namespace clang::tooling;
+        ArgumentsAdjuster adjuster = combineAdjusters(getClangStripOutputAdjuster(),
+                                                      getClangSyntaxOnlyAdjuster());
+        adjuster = combineAdjusters(adjuster, getClangStripDependencyFileAdjuster());
+        return combineAdjusters(adjuster, resourceDirAdjuster());
+    }
+
+    // Answers from the loaded database and falls back to the default flags for files it
+    // does not know, so a single file outside the project can still be analyzed.
+    class FallbackDatabase : public clang::tooling::CompilationDatabase {
+    public:
+        explicit FallbackDatabase(std::shared_ptr<const Database> primary)
+            : m_primary(std::move(primary)), m_fallback(".", defaultArguments()) {}
+
+        std::vector<clang::tooling::CompileCommand>
+        getCompileCommands(llvm::StringRef FilePath) const override {
+            if (m_primary) {
+                auto commands = m_primary->getCompileCommands(FilePath);
+                if (!commands.empty()) return commands;
+            }
+            return m_fallback.getCompileCommands(FilePath);
+        }
+
+        std::vector<std::string> getAllFiles() const override {
+            return m_primary ? m_primary->getAllFiles() : std::vector<std::string>();
+        }
+
+        std::vector<clang::tooling::CompileCommand> getAllCompileCommands() const override {
+            return m_primary ? m_primary->getAllCompileCommands()
+                             : std::vector<clang::tooling::CompileCommand>();
+        }
+
+    private:
+        std::shared_ptr<const Database> m_primary;
+        clang::tooling::FixedCompilationDatabase m_fallback;
+    };
+
+} // namespace
+
+clang::tooling::ArgumentsAdjuster resourceDirAdjuster() {
+    std::string resourceDir = resourceDirectory();
+    if (resourceDir.empty()) {
+        return [](const clang::tooling::CommandLineArguments& args, llvm::StringRef) {
+            return args;
+        };
+    }
+    return clang::tooling::getInsertArgumentAdjuster(
+        ("-resource-dir=" + resourceDir).c_str(), clang::tooling::ArgumentInsertPosition::END);
+}
+
+const std::vector<std::string>& defaultArguments() {
+    static const std::vector<std::string> args = {
+        "-std=c++17",
+        "-I.",
+        "-I/usr/include",
+        "-I/usr/local/include"
+    };
+    return args;
+}
+
+std::shared_ptr<const Database> load(const std::string& path, std::string& errorMessage) {
+    std::unique_ptr<Database> db;
+    if (llvm::sys::fs::is_directory(path)) {
+        db = clang::tooling::CompilationDatabase::loadFromDirectory(path, errorMessage);
+    } else {
+        db = clang::tooling::JSONCompilationDatabase::loadFromFile(
+            path, errorMessage, clang::tooling::JSONCommandLineSyntax::AutoDetect);
+    }
+    return std::shared_ptr<const Database>(std::move(db));
+}
+
+std::string discover(const std::string& sourceFile) {
+    std::error_code ec;
+    fs::path dir = fs::absolute(sourceFile, ec).parent_path();
+
+    while (!dir.empty()) {
+        for (const fs::path& candidate : { dir / "compile_commands.json",
+                                           dir / "build" / "compile_commands.json" }) {
+            if (fs::exists(candidate, ec)) {
+                return candidate.string();
+            }
+        }
+        if (dir == dir.root_path()) break;
+        dir = dir.parent_path();
+    }
+    return "";
+}
+
+std::shared_ptr<const Database> orDefault(std::shared_ptr<const Database> compilations) {
+    return std::make_shared<FallbackDatabase>(std::move(compilations));
+}
+
+std::vector<std::string> commandLineForFile(const Database* compilations,
+                                            const std::string& filename,
+                                            std::string* workingDirectory) {
+    std::vector<std::string> commandLine;
+    std::string directory = ".";
+
+    if (compilations) {
+        std::vector<clang::tooling::CompileCommand> commands =
+            compilations->getCompileCommands(filename);
+        if (!commands.empty()) {
+            commandLine = commands.front().CommandLine;
+            directory = commands.front().Directory;
+        }
+    }
+
+    if (commandLine.empty()) {
+        commandLine.push_back("clang++");
+        commandLine.insert(commandLine.end(), defaultArguments().begin(), defaultArguments().end());
+        commandLine.push_back(filename);
+    }
+
+    if (workingDirectory) {
+        *workingDirectory = directory;
+    }
+    return syntaxOnlyAdjuster()(commandLine, filename);
+}
+
+} // namespace CompileCommands
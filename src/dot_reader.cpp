@@ -0,0 +1,481 @@
+#include "dot_reader.h"
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+
+namespace {
+
+    struct IdentifierChars {
+        bool table[256] = {};
+        IdentifierChars() {
+            for (int c = 0; c < 256; ++c) {
+                table[c] = (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') ||
+                           (c >= '0' && c <= '9') || c == '_' || c >= 0x80;
+            }
+        }
+    };
+
+    // Table lookup; std::isalnum would consult the locale for every byte
+    bool isIdentifierChar(char c) {
+        static const IdentifierChars chars;
+        return chars.table[static_cast<unsigned char>(c)];
+    }
+
+    bool isDigit(char c) {
+        return c >= '0' && c <= '9';
+    }
+
+    // Contents of a quoted string with \" and line continuations resolved
+    void unescapeQuoted(std::string_view text, std::string& out) {
+        out.reserve(out.size() + text.size());
+        for (size_t i = 0; i < text.size(); ++i) {
+            if (text[i] == '\\' && i + 1 < text.size()) {
+                char escaped = text[i + 1];
+                if (escaped == '"') {
+                    out += '"';
+                    ++i;
+                    continue;
+                }
+                if (escaped == '\n') {
+                    ++i;
+                    continue;
+                }
+                if (escaped == '\r') {
+                    i += (i + 2 < text.size() && text[i + 2] == '\n') ? 2 : 1;
+                    continue;
+                }
+                // Label escapes such as \n or \\ are left to the consumer
+                out += '\\';
+                out += escaped;
+                ++i;
+                continue;
+            }
+            out += text[i];
+        }
+    }
+
+} // namespace
+
+bool DotReader::parse(std::string_view input, Handler& handler) {
+    m_input = input;
+    m_pos = 0;
+    m_tokenStart = 0;
+    m_hasPeeked = false;
+    m_depth = 0;
+    m_members.clear();
+    m_operands.clear();
+    m_scratch.clear();
+    m_error.clear();
+
+    // [strict] (graph|digraph) [ID] '{' stmt_list '}', any number of times
+    while (true) {
+        Token token = next();
+        if (token == Token::End) return true;
+        if (token == Token::ID && isKeyword("strict")) {
+            token = next();
+        }
+        if (token != Token::ID || !(isKeyword("graph") || isKeyword("digraph"))) {
+            return fail("expected 'graph' or 'digraph'");
+        }
+        token = next();
+        if (token == Token::ID) {
+            token = next();
+        }
+        if (token != Token::LeftBrace) return fail("expected '{'");
+        if (!parseStatementList(handler)) return false;
+    }
+}
+
+std::string_view DotReader::find(const Attributes& attributes, std::string_view name) {
+    for (auto it = attributes.rbegin(); it != attributes.rend(); ++it) {
+        if (it->name == name) return it->value;
+    }
+    return {};
+}
+
+std::string DotReader::unescapeLabel(std::string_view label) {
+    std::string result;
+    result.reserve(label.size());
+    for (size_t i = 0; i < label.size(); ++i) {
+        if (label[i] == '\\' && i + 1 < label.size()) {
+            char escaped = label[++i];
+            switch (escaped) {
+            case 'n':
+            case 'l':
+            case 'r': result += '\n'; continue;
+            case '\\':
+            case '"': result += escaped; continue;
+            default: result += '\\'; break;
+            }
+            result += escaped;
+            continue;
+        }
+        result += label[i];
+    }
+    return result;
+}
+
+bool DotReader::toInt(std::string_view id, int& value) {
+    if (id.empty()) return false;
+    const char* end = id.data() + id.size();
+    auto result = std::from_chars(id.data(), end, value);
+    return result.ec == std::errc() && result.ptr == end;
+}
+
+DotReader::Token DotReader::next() {
+    if (m_hasPeeked) {
+        m_hasPeeked = false;
+        m_text = m_peekedText;
+        m_quoted = m_peekedQuoted;
+        return m_peeked;
+    }
+    return scan(m_text, m_quoted);
+}
+
+DotReader::Token DotReader::peek() {
+    if (!m_hasPeeked) {
+        m_peeked = scan(m_peekedText, m_peekedQuoted);
+        m_hasPeeked = true;
+    }
+    return m_peeked;
+}
+
+void DotReader::skipSpaceAndComments() {
+    const size_t size = m_input.size();
+    while (m_pos < size) {
+        char c = m_input[m_pos];
+        if (c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\f' || c == '\v') {
+            ++m_pos;
+            continue;
+        }
+        if (c == '/' && m_pos + 1 < size && m_input[m_pos + 1] == '/') {
+            m_pos = std::min(m_input.find('\n', m_pos), size);
+            continue;
+        }
+        if (c == '/' && m_pos + 1 < size && m_input[m_pos + 1] == '*') {
+            size_t end = m_input.find("*/", m_pos + 2);
+            m_pos = end == std::string_view::npos ? size : end + 2;
+            continue;
+        }
+        if (c == '#') {
+            // Preprocessor output lines are skipped; '#' elsewhere is an error
+            size_t lineStart = m_pos;
+            while (lineStart > 0 && (m_input[lineStart - 1] == ' ' || m_input[lineStart - 1] == '\t')) {
+                --lineStart;
+            }
+            if (lineStart == 0 || m_input[lineStart - 1] == '\n') {
+                m_pos = std::min(m_input.find('\n', m_pos), size);
+                continue;
+            }
+        }
+        break;
+    }
+}
+
+DotReader::Token DotReader::scan(std::string_view& text, bool& quoted) {
+    skipSpaceAndComments();
+    quoted = false;
+    m_tokenStart = m_pos;
+    if (m_pos >= m_input.size()) return Token::End;
+
+    char c = m_input[m_pos];
+    switch (c) {
+    case '{': ++m_pos; return Token::LeftBrace;
+    case '}': ++m_pos; return Token::RightBrace;
+    case '[': ++m_pos; return Token::LeftBracket;
+    case ']': ++m_pos; return Token::RightBracket;
+    case ';': ++m_pos; return Token::Semicolon;
+    case ',': ++m_pos; return Token::Comma;
+    case '=': ++m_pos; return Token::Equals;
+    case ':': ++m_pos; return Token::Colon;
+    case '"': quoted = true; return scanQuoted(text);
+    case '<': quoted = true; return scanHtml(text);
+    default: break;
+    }
+
+    if (c == '-' && m_pos + 1 < m_input.size() &&
+        (m_input[m_pos + 1] == '>' || m_input[m_pos + 1] == '-')) {
+        m_pos += 2;
+        return Token::EdgeOp;
+    }
+
+    size_t start = m_pos;
+    if (isIdentifierChar(c) && !isDigit(c)) {
+        while (m_pos < m_input.size() && isIdentifierChar(m_input[m_pos])) ++m_pos;
+        text = m_input.substr(start, m_pos - start);
+        return Token::ID;
+    }
+
+    // Numeral: [-]?(.[0-9]+ | [0-9]+(.[0-9]*)?)
+    if (c == '-') ++m_pos;
+    bool digits = false;
+    while (m_pos < m_input.size() && isDigit(m_input[m_pos])) {
+        ++m_pos;
+        digits = true;
+    }
+    if (m_pos < m_input.size() && m_input[m_pos] == '.') {
+        ++m_pos;
+        while (m_pos < m_input.size() && isDigit(m_input[m_pos])) {
+            ++m_pos;
+            digits = true;
+        }
+    }
+    if (!digits) {
+        m_pos = start;
+        fail("unexpected character");
+        return Token::Error;
+    }
+    text = m_input.substr(start, m_pos - start);
+    return Token::ID;
+}
+
+DotReader::Token DotReader::scanQuoted(std::string_view& text) {
+    std::string* joined = nullptr;
+
+    // "..." ["+" "..."]*
+    while (true) {
+        size_t start = ++m_pos;
+        bool escapes = false;
+        const size_t size = m_input.size();
+        while (true) {
+            while (m_pos < size && m_input[m_pos] != '"' && m_input[m_pos] != '\\') ++m_pos;
+            if (m_pos >= size) {
+                m_pos = m_tokenStart;
+                fail("unterminated string");
+                return Token::Error;
+            }
+            if (m_input[m_pos] == '"') break;
+            if (m_pos + 1 < m_input.size()) {
+                char escaped = m_input[m_pos + 1];
+                escapes = escapes || escaped == '"' || escaped == '\n' || escaped == '\r';
+            }
+            m_pos += 2;
+        }
+        std::string_view part = m_input.substr(start, m_pos - start);
+        ++m_pos;
+
+        if (!joined && !escapes) {
+            text = part;
+        } else {
+            if (!joined) {
+                joined = &m_scratch.emplace_back();
+            }
+            unescapeQuoted(part, *joined);
+            text = *joined;
+        }
+
+        size_t afterString = m_pos;
+        skipSpaceAndComments();
+        if (m_pos < m_input.size() && m_input[m_pos] == '+') {
+            ++m_pos;
+            skipSpaceAndComments();
+            if (m_pos < m_input.size() && m_input[m_pos] == '"') {
+                if (!joined) {
+                    joined = &m_scratch.emplace_back(text);
+                }
+                continue;
+            }
+        }
+        m_pos = afterString;
+        return Token::ID;
+    }
+}
+
+DotReader::Token DotReader::scanHtml(std::string_view& text) {
+    size_t start = m_pos + 1;
+    int depth = 0;
+    for (; m_pos < m_input.size(); ++m_pos) {
+        if (m_input[m_pos] == '<') {
+            ++depth;
+        } else if (m_input[m_pos] == '>' && --depth == 0) {
+            text = m_input.substr(start, m_pos - start);
+            ++m_pos;
+            return Token::ID;
+        }
+    }
+    m_pos = m_tokenStart;
+    fail("unterminated HTML string");
+    return Token::Error;
+}
+
+bool DotReader::isKeyword(const char* keyword) const {
+    if (m_quoted) return false;
+    size_t i = 0;
+    for (; keyword[i]; ++i) {
+        if (i >= m_text.size() ||
+            std::tolower(static_cast<unsigned char>(m_text[i])) != keyword[i]) {
+            return false;
+        }
+    }
+    return i == m_text.size();
+}
+
+void DotReader::releaseScratch() {
+    if (m_scratch.empty()) return;
+
+    // Keep the string behind an already peeked token
+    if (m_hasPeeked && m_peeked == Token::ID && m_peekedText.data() == m_scratch.back().data()) {
+        std::string kept = std::move(m_scratch.back());
+        m_scratch.clear();
+        m_peekedText = m_scratch.emplace_back(std::move(kept));
+        return;
+    }
+    m_scratch.clear();
+}
+
+bool DotReader::parseStatementList(Handler& handler) {
+    ++m_depth;
+    if (m_attributeLists.size() <= m_depth) {
+        m_attributeLists.resize(m_depth + 1);
+    }
+
+    while (true) {
+        Token token = peek();
+        if (m_depth == 1) {
+            // Nothing of the previous top-level statement is referenced any more
+            m_members.clear();
+            releaseScratch();
+        }
+        if (token == Token::RightBrace) {
+            next();
+            --m_depth;
+            return true;
+        }
+        if (token == Token::End) return fail("missing '}'");
+        if (token == Token::Semicolon) {
+            next();
+            continue;
+        }
+        if (!parseStatement(handler)) return false;
+    }
+}
+
+bool DotReader::parseStatement(Handler& handler) {
+    Token token = next();
+
+    if (token == Token::ID) {
+        bool isDefaults = true;
+        DefaultsKind kind = DefaultsKind::Graph;
+        if (isKeyword("node")) {
+            kind = DefaultsKind::Node;
+        } else if (isKeyword("edge")) {
+            kind = DefaultsKind::Edge;
+        } else if (!isKeyword("graph")) {
+            isDefaults = false;
+        }
+        if (isDefaults) {
+            if (peek() != Token::LeftBracket) return fail("expected '['");
+            Attributes& attributes = m_attributeLists[m_depth];
+            attributes.clear();
+            if (!parseAttributeList(attributes)) return false;
+            handler.defaults(kind, attributes);
+            return true;
+        }
+
+        if (peek() == Token::Equals) {
+            std::string_view name = m_text;
+            next();
+            if (next() != Token::ID) return fail("expected a value after '='");
+            Attributes& attributes = m_attributeLists[m_depth];
+            attributes.assign(1, Attribute{name, m_text});
+            handler.defaults(DefaultsKind::Graph, attributes);
+            return true;
+        }
+    }
+
+    bool isSubgraph = token == Token::LeftBrace || (token == Token::ID && isKeyword("subgraph"));
+    size_t begin = 0;
+    if (!parseOperand(token, handler, begin)) return false;
+    size_t end = m_members.size();
+
+    if (peek() != Token::EdgeOp) {
+        if (isSubgraph) return true;
+        Attributes& attributes = m_attributeLists[m_depth];
+        attributes.clear();
+        if (!parseAttributeList(attributes)) return false;
+        handler.node(m_members[begin], attributes);
+        return true;
+    }
+
+    // Edge chain; each operand is a node or the nodes of a subgraph
+    size_t operandsBase = m_operands.size();
+    m_operands.emplace_back(begin, end);
+    while (peek() == Token::EdgeOp) {
+        next();
+        if (!parseOperand(next(), handler, begin)) return false;
+        m_operands.emplace_back(begin, m_members.size());
+    }
+
+    Attributes& attributes = m_attributeLists[m_depth];
+    attributes.clear();
+    if (!parseAttributeList(attributes)) return false;
+
+    for (size_t i = operandsBase + 1; i < m_operands.size(); ++i) {
+        const auto& from = m_operands[i - 1];
+        const auto& to = m_operands[i];
+        for (size_t source = from.first; source < from.second; ++source) {
+            for (size_t target = to.first; target < to.second; ++target) {
+                handler.edge(m_members[source], m_members[target], attributes);
+            }
+        }
+    }
+    m_operands.resize(operandsBase);
+    return true;
+}
+
+bool DotReader::parseOperand(Token token, Handler& handler, size_t& begin) {
+    begin = m_members.size();
+
+    if (token == Token::LeftBrace || (token == Token::ID && isKeyword("subgraph"))) {
+        if (token != Token::LeftBrace) {
+            token = next();
+            if (token == Token::ID) {
+                token = next();
+            }
+            if (token != Token::LeftBrace) return fail("expected '{' after 'subgraph'");
+        }
+        return parseStatementList(handler);
+    }
+
+    if (token != Token::ID) return fail("expected a node ID");
+    m_members.push_back(m_text);
+
+    // node_id [':' port [':' compass_pt]]; ports do not affect the graph
+    while (peek() == Token::Colon) {
+        next();
+        if (next() != Token::ID) return fail("expected a port after ':'");
+    }
+    return true;
+}
+
+bool DotReader::parseAttributeList(Attributes& attributes) {
+    // ('[' (ID ['=' ID] [';'|','])* ']')*
+    while (peek() == Token::LeftBracket) {
+        next();
+        while (true) {
+            Token token = next();
+            if (token == Token::RightBracket) break;
+            if (token == Token::Comma || token == Token::Semicolon) continue;
+            if (token != Token::ID) return fail("expected an attribute name");
+
+            std::string_view name = m_text;
+            std::string_view value = "true";
+            if (peek() == Token::Equals) {
+                next();
+                if (next() != Token::ID) return fail("expected an attribute value");
+                value = m_text;
+            }
+            attributes.push_back(Attribute{name, value});
+        }
+    }
+    return true;
+}
+
+bool DotReader::fail(const char* message) {
+    // Keep the first error; later ones are consequences of it
+    if (m_error.empty()) {
+        size_t line = 1 + std::count(m_input.begin(), m_input.begin() + m_tokenStart, '\n');
+        m_error = "line " + std::to_string(line) + ": " + message;
+    }
+    return false;
+}
@@ -0,0 +1,107 @@
+#include "dot_writer.h"
+#include <cctype>
+#include <charconv>
+
+namespace {
+
+    constexpr size_t FlushThreshold = 64 * 1024;
+
+    bool isPlainIdentifier(std::string_view name) {
+        if (name.empty() || std::isdigit(static_cast<unsigned char>(name.front()))) return false;
+        for (char c : name) {
+            if (!std::isalnum(static_cast<unsigned char>(c)) && c != '_') return false;
+        }
+        return true;
+    }
+
+} // namespace
+
+DotWriter::DotWriter(std::string& out) : m_string(&out) {}
+
+DotWriter::DotWriter(std::ostream& out) : m_stream(&out) {
+    m_buffer.reserve(FlushThreshold + 4096);
+}
+
+DotWriter::~DotWriter() {
+    flush();
+}
+
+void DotWriter::reserve(size_t bytes) {
+    if (m_string) {
+        m_string->reserve(m_string->size() + bytes);
+    }
+}
+
+size_t DotWriter::estimateSize(size_t nodeCount, size_t edgeCount) {
+    return 256 + nodeCount * 64 + edgeCount * 32;
+}
+
+bool DotWriter::flush() {
+    if (m_stream) {
+        if (!m_buffer.empty()) {
+            m_stream->write(m_buffer.data(), static_cast<std::streamsize>(m_buffer.size()));
+            m_buffer.clear();
+        }
+        m_stream->flush();
+        return static_cast<bool>(*m_stream);
+    }
+    return true;
+}
+
+DotWriter& DotWriter::raw(std::string_view text) {
+    if (m_string) {
+        m_string->append(text.data(), text.size());
+        return *this;
+    }
+    m_buffer.append(text.data(), text.size());
+    if (m_buffer.size() >= FlushThreshold) {
+        m_stream->write(m_buffer.data(), static_cast<std::streamsize>(m_buffer.size()));
+        m_buffer.clear();
+    }
+    return *this;
+}
+
+DotWriter& DotWriter::raw(char c) {
+    return raw(std::string_view(&c, 1));
+}
+
+DotWriter& DotWriter::number(long long value) {
+    char digits[24];
+    auto result = std::to_chars(digits, digits + sizeof(digits), value);
+    return raw(std::string_view(digits, result.ptr - digits));
+}
+
+DotWriter& DotWriter::escaped(std::string_view text) {
+    size_t runStart = 0;
+    for (size_t i = 0; i < text.size(); ++i) {
+        char c = text[i];
+        if (c != '"' && c != '\\' && c != '\n' && c != '\r') continue;
+
+        raw(text.substr(runStart, i - runStart));
+        switch (c) {
+        case '"': raw("\\\""); break;
+        case '\\': raw("\\\\"); break;
+        case '\n': raw("\\n"); break;
+        default: break;  // \r of a CRLF pair
+        }
+        runStart = i + 1;
+    }
+    return raw(text.substr(runStart));
+}
+
+DotWriter& DotWriter::beginGraph(std::string_view name) {
+    raw("digraph ");
+    if (isPlainIdentifier(name)) {
+        raw(name);
+    } else {
+        quoted(name);
+    }
+    return raw(" {\n");
+}
+
+DotWriter& DotWriter::edge(long long from, long long to) {
+    raw("  ");
+    number(from);
+    raw(" -> ");
+    return number(to);
+}
@@ -0,0 +1,26 @@
+#include "file_hash.h"
+#include <llvm/Support/MemoryBuffer.h>
+#include <llvm/Support/Process.h>
+#include <llvm/Support/xxhash.h>
+#include <sstream>
+
+namespace file_hash {
+
+    std::string toHex(uint64_t value) {
+        std::ostringstream out;
+        out << std::hex << value;
+        return out.str();
+    }
+
+    bool hashFile(const std::string& path, uint64_t& hash) {
+        auto buffer = llvm::MemoryBuffer::getFile(path);
+        if (!buffer) return false;
+        hash = llvm::xxHash64((*buffer)->getBuffer());
+        return true;
+    }
+
+    std::string tempSuffix() {
+        return ".tmp" + std::to_string(llvm::sys::Process::getProcessId());
+    }
+
+} // namespace file_hash
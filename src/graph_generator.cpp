@@ -8,6 +8,7 @@
 #include <clang/AST/Stmt.h>
 #include <nlohmann/json.hpp>
 #include <clang/AST/ASTContext.h>
+#include <clang/Lex/Lexer.h>
 
 using json = nlohmann::json;
 
@@ -22,12 +23,66 @@ namespace GraphGenerator {
         return stmtStr;
     }
 
-    void extractStatementsFromBlock(const clang::CFGBlock* block, CFGGraph* graph) {
+    static clang::CharSourceRange getStmtFileRange(const clang::Stmt* S,
+                                                   const clang::SourceManager& SM,
+                                                   const clang::LangOptions& langOpts) {
+        if (!S) return clang::CharSourceRange();
+        // Statements from macros map to the macro use, so this works for them too
+        clang::CharSourceRange range = SM.getExpansionRange(S->getSourceRange());
+        return clang::Lexer::makeFileCharRange(range, SM, langOpts);
+    }
+
+    llvm::StringRef getStmtSourceText(const clang::Stmt* S, const clang::ASTContext& context) {
+        const clang::SourceManager& SM = context.getSourceManager();
+        clang::CharSourceRange range = getStmtFileRange(S, SM, context.getLangOpts());
+        if (range.isInvalid()) return llvm::StringRef();
+
+        bool invalid = false;
+        llvm::StringRef text = clang::Lexer::getSourceText(range, SM, context.getLangOpts(), &invalid);
+        return invalid ? llvm::StringRef() : text;
+    }
+
+    // Statements are recorded as their source text, interned into the graph's pool; only
+    // the statement's own range is copied, and repeated statements are stored once. Only
+    // statements without a usable file range are pretty-printed.
+    class StatementRecorder {
+    public:
+        StatementRecorder(const clang::ASTContext& context, StatementPool& pool)
+            : m_context(context),
+              m_sourceManager(context.getSourceManager()),
+              m_pool(pool) {}
+
+        StatementPool::Handle record(const clang::Stmt* S) {
+            llvm::StringRef text = getStmtSourceText(S, m_context);
+            if (!text.empty()) {
+                return m_pool.intern(std::string_view(text.data(), text.size()));
+            }
+            return m_pool.intern(getStmtString(S));
+        }
+
+        unsigned lineOf(const clang::Stmt* S) const {
+            clang::PresumedLoc loc = m_sourceManager.getPresumedLoc(
+                m_sourceManager.getExpansionLoc(S->getBeginLoc()));
+            return loc.isValid() ? loc.getLine() : 0;
+        }
+
+    private:
+        const clang::ASTContext& m_context;
+        const clang::SourceManager& m_sourceManager;
+        StatementPool& m_pool;
+    };
+
+    void extractStatementsFromBlock(const clang::CFGBlock* block, CFGGraph* graph,
+                                    StatementRecorder& recorder) {
+        bool first = true;
         for (const auto& element : *block) {
             if (element.getKind() == clang::CFGElement::Statement) {
                 const clang::Stmt* stmt = element.castAs<clang::CFGStmt>().getStmt();
-                std::string stmtStr = getStmtString(stmt);
-                graph->addStatement(block->getBlockID(), stmtStr);
+                if (first) {
+                    graph->setNodeLine(block->getBlockID(), recorder.lineOf(stmt));
+                    first = false;
+                }
+                graph->addStatementHandle(block->getBlockID(), recorder.record(stmt));
             }
         }
     }
@@ -58,15 +113,21 @@ namespace GraphGenerator {
 
     void handleSuccessors(const clang::CFGBlock* block, CFGGraph* graph) {
         int blockID = block->getBlockID();
+        // Two-way terminators list the true branch first; the CSR forgets successor order
+        bool isBranch = block->succ_size() == 2 && block->getTerminatorCondition();
 
-        for (auto succ = block->succ_begin(); succ != block->succ_end(); ++succ) {
+        unsigned index = 0;
+        for (auto succ = block->succ_begin(); succ != block->succ_end(); ++succ, ++index) {
             if (*succ) {
-                graph->addEdge(blockID, (*succ)->getBlockID());
+                uint8_t flags = !isBranch ? 0
+                    : index == 0 ? CFGGraph::TrueBranch : CFGGraph::FalseBranch;
+                graph->addEdge(blockID, (*succ)->getBlockID(), flags);
             }
         }
     }
 
-    std::unique_ptr<CFGGraph> generateCFG(const clang::FunctionDecl* FD) {
+    std::unique_ptr<CFGGraph> generateCFG(const clang::FunctionDecl* FD,
+                                          std::shared_ptr<StatementPool> statements) {
         if (!FD || !FD->hasBody()) return nullptr;
         
         // Handle template functions
@@ -85,7 +146,7 @@ namespace GraphGenerator {
             }
         }
 
-        auto graph = std::make_unique<CFGGraph>();
+        auto graph = std::make_unique<CFGGraph>(std::move(statements));
         std::unique_ptr<clang::CFG> cfg = clang::CFG::buildCFG(
             actualFD, 
             actualFD->getBody(), 
@@ -112,11 +173,12 @@ namespace GraphGenerator {
         }
 
 
+        StatementRecorder recorder(actualFD->getASTContext(), *graph->statementPool());
         for (const auto* block : *cfg) {
             if (!block) continue;
             
             graph->addNode(block->getBlockID());
-            extractStatementsFromBlock(block, graph.get());
+            extractStatementsFromBlock(block, graph.get(), recorder);
             handleTryAndCatch(block, graph.get(), stmtToBlock);
             handleSuccessors(block, graph.get());
         }
@@ -1,10 +1,9 @@
 #include "graphical_cfg_node.h"
-#include "node.h" 
 #include <QGraphicsSceneMouseEvent>
 #include <QStyleOptionGraphicsItem>
 
-GraphicalCFGNode::GraphicalCFGNode(const std::shared_ptr<CFGNode>& cfgNode, QGraphicsItem* parent)
-    : QGraphicsItem(parent), m_cfgNode(cfgNode), m_color(Qt::blue) {
+GraphicalCFGNode::GraphicalCFGNode(const CFGNodeGraph& graph, CFGNode::Handle node, QGraphicsItem* parent)
+    : QGraphicsItem(parent), m_graph(&graph), m_node(node), m_color(Qt::blue) {
     setFlag(QGraphicsItem::ItemIsMovable);
     setFlag(QGraphicsItem::ItemIsSelectable);
 }
@@ -19,8 +18,10 @@ void GraphicalCFGNode::paint(QPainter* painter, const QStyleOptionGraphicsItem*
     // Draw node rectangle
     QRectF rect = boundingRect();
     
+    const CFGNode* cfgNode = m_graph && m_graph->contains(m_node) ? &m_graph->node(m_node) : nullptr;
+
     // Set color based on node type
-    switch (m_cfgNode->getType()) {
+    switch (cfgNode ? cfgNode->getType() : CFGNode::BASIC_BLOCK) {
         case CFGNode::ENTRY:
             m_color = Qt::green;
             break;
@@ -48,8 +49,7 @@ void GraphicalCFGNode::paint(QPainter* painter, const QStyleOptionGraphicsItem*
     painter->drawRect(rect);
 
     // Draw node content
-    painter->drawText(rect, Qt::AlignCenter | Qt::TextWordWrap, 
-        QString::fromStdString(m_cfgNode->getContent()));
+    painter->drawText(rect, Qt::AlignCenter | Qt::TextWordWrap, getNodeLabel());
 }
 
 void GraphicalCFGNode::setColor(const QColor& color) {
@@ -58,7 +58,10 @@ void GraphicalCFGNode::setColor(const QColor& color) {
 }
 
 QString GraphicalCFGNode::getNodeLabel() const {
-    return QString::fromStdString(m_cfgNode->getContent());
+    if (!m_graph || !m_graph->contains(m_node)) {
+        return m_label;
+    }
+    return QString::fromStdString(m_graph->node(m_node).getContent());
 }
 
 void GraphicalCFGNode::mousePressEvent(QGraphicsSceneMouseEvent* event) {
@@ -1,4 +1,5 @@
 #include "cfg_gui.h"
+#include "analysis_session.h"
 #include "cfg_analyzer.h"
 #include "parser.h"
 #include "graph_generator.h"
@@ -659,31 +660,30 @@ namespace CFGAnalyzer {
         outputConsole->clear();
         outputConsole->append("Parsing file: " + filePath);
     
-        Parser parser;
-        std::vector<Parser::FunctionInfo> functions;  // Add this declaration
-        
-        if (parser.isDotFile(filePath.toStdString())) {
-            functions = parser.extractFunctionsFromDot(filePath.toStdString());
+        std::string filename = filePath.toStdString();
+        if (Parser::isDotFile(filename)) {
+            QFile dotFile(filePath);
+            if (!dotFile.open(QIODevice::ReadOnly | QIODevice::Text)) {
+                outputConsole->append("Failed to open DOT file");
+                return;
+            }
             outputConsole->append("Processing DOT file format");
-        } else {
-            functions = parser.extractFunctions(filePath.toStdString());
-            outputConsole->append("Processing source code file");
+            renderDotGraph(QString::fromUtf8(dotFile.readAll()));
+            return;
         }
+        outputConsole->append("Processing source code file");
     
-        // Step 2: Generate CFG
-        std::vector<std::unique_ptr<GraphGenerator::CFGGraph>> cfgGraphs;
-        
-        // Get AST context (ensure parseFile() is public in Parser)
-        clang::ASTContext* astContext = parser.parseFile(filePath.toStdString());
-        if (!astContext) {
+        // Shares the parse with the main window's actions on the same file
+        auto session = AnalysisSession::forFile(filename);
+        if (!session->open(filename)) {
             outputConsole->append("Failed to parse file");
             return;
         }
     
-        // Process each function
-        for (const auto& functionInfo : functions) {
-            auto cfg = GraphGenerator::generateCFG(functionInfo, astContext);
-            if (cfg) {
+        // Step 2: Generate CFG
+        std::vector<std::shared_ptr<GraphGenerator::CFGGraph>> cfgGraphs;
+        for (const auto& function : session->functions()) {
+            if (auto cfg = session->functionCFG(function.usr)) {
                 cfgGraphs.push_back(std::move(cfg));
             }
         }
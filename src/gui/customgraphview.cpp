@@ -1,5 +1,8 @@
 #include "customgraphview.h"
 #include "mainwindow.h"
+#include "graph_generator.h"
+#include "dot_reader.h"
+#include "cfg_json_reader.h"
 #include <QGraphicsEllipseItem>
 #include <QRegExp>
 #include <QDebug>
@@ -15,8 +18,12 @@
 #include <QQueue>
 #include <QPair>
 #include <QTimer>
+#include <QToolTip>
 #include <cmath>
 #include <exception>
+#include <unordered_map>
+
+const int CustomGraphView::FullLabelKey = QGraphicsItem::UserType + 3;
 
 CustomGraphView::CustomGraphView(QWidget* parent) 
     : QGraphicsView(parent),
@@ -67,7 +74,8 @@ void CustomGraphView::paintEvent(QPaintEvent* event)
     }
 }
 QGraphicsTextItem* CustomGraphView::createNodeItem(const QString& label, bool isNewFile) {
-    QGraphicsTextItem* nodeItem = m_scene->addText(label);
+    QGraphicsTextItem* nodeItem = m_scene->addText(QString());
+    setLabelText(nodeItem, label);
     
     if (isNewFile) {
         nodeItem->setDefaultTextColor(Qt::blue);
@@ -276,6 +284,7 @@ void CustomGraphView::applyHierarchicalLayout() {
         
         m_nodes[id]->setPos(x, y);
     }
+    updateEdgePositions();
 }
 
 void CustomGraphView::applyForceDirectedLayout(int iterations, 
@@ -338,6 +347,7 @@ void CustomGraphView::applyForceDirectedLayout(int iterations,
     foreach (const QString& id, m_nodes.keys()) {
         m_nodes[id]->setPos(positions[id]);
     }
+    updateEdgePositions();
 }
 
 void CustomGraphView::applyCircularLayout() {
@@ -357,6 +367,72 @@ void CustomGraphView::applyCircularLayout() {
         m_nodes[id]->setPos(x, y);
         i++;
     }
+    updateEdgePositions();
+}
+
+void CustomGraphView::updateEdgePositions() {
+    if (!m_scene) return;
+
+    for (QGraphicsItem* item : m_scene->items()) {
+        auto edge = dynamic_cast<QGraphicsLineItem*>(item);
+        if (!edge || edge->data(0).toString() != "edge") continue;
+
+        QGraphicsEllipseItem* fromItem = m_nodes.value(edge->data(1).toString());
+        QGraphicsEllipseItem* toItem = m_nodes.value(edge->data(2).toString());
+        if (fromItem && toItem) {
+            edge->setLine(QLineF(fromItem->rect().center() + fromItem->pos(),
+                                 toItem->rect().center() + toItem->pos()));
+        }
+    }
+}
+
+void CustomGraphView::displayCFG(const GraphGenerator::CFGGraph& graph) {
+    clear();
+    if (!m_scene) return;
+    m_scene->clear();  // drop clear()'s placeholder text
+
+    // Same styling as Visualizer::generateDotRepresentation
+    for (const auto& [id, node] : graph.getNodes()) {
+        QString nodeId = QString::number(id);
+        QBrush fill(Qt::lightGray);
+        if (graph.isNodeTryBlock(id)) fill = QBrush(QColor("lightblue"));
+        if (graph.isNodeThrowingException(id)) fill = QBrush(QColor("lightcoral"));
+        QPen outline(Qt::black);
+        if (node.successors.size() > 1) outline = QPen(Qt::gray, 1, Qt::DashLine);
+
+        QGraphicsEllipseItem* ellipse = m_scene->addEllipse(0, 0, 80, 40, outline, fill);
+        ellipse->setData(0, nodeId);
+        ellipse->setData(MainWindow::NodeItemType, 1);
+
+        QGraphicsTextItem* text = new QGraphicsTextItem(ellipse);
+        setLabelText(text, QString::fromStdString(graph.getNodeLabel(id)));
+        text->setPos(5, 10);
+
+        m_nodes[nodeId] = ellipse;
+        m_nodesMap[id] = ellipse;
+    }
+
+    for (const auto& [id, node] : graph.getNodes()) {
+        QString from = QString::number(id);
+        for (int successor : node.successors) {
+            QString to = QString::number(successor);
+            QPen pen(Qt::black, 1.5);
+            if (graph.isExceptionEdge(id, successor)) {
+                pen = QPen(Qt::red, 1.5, Qt::DashLine);
+            }
+
+            QGraphicsLineItem* edge = m_scene->addLine(QLineF(), pen);
+            edge->setZValue(-1);
+            edge->setData(0, "edge");  // Mark as edge
+            edge->setData(1, from);    // Store source
+            edge->setData(2, to);      // Store target
+            edge->setData(MainWindow::EdgeItemType, 1);
+            m_edges.append(qMakePair(from, to));
+        }
+    }
+
+    applyHierarchicalLayout();
+    m_scene->setSceneRect(m_scene->itemsBoundingRect().adjusted(-20, -20, 20, 20));
 }
 
 void CustomGraphView::parsePlainFormat(const QString& plainOutput) {
@@ -407,6 +483,11 @@ void CustomGraphView::parsePlainFormat(const QString& plainOutput) {
 }
 
 bool CustomGraphView::parseDotFormat(const QString& dotContent) {
+    QByteArray utf8 = dotContent.toUtf8();
+    return parseDotFormat(std::string_view(utf8.constData(), static_cast<size_t>(utf8.size())));
+}
+
+bool CustomGraphView::parseDotFormat(std::string_view dotContent) {
     if (!scene()) {
         qWarning() << "No scene available for parsing";
         return false;
@@ -415,153 +496,97 @@ bool CustomGraphView::parseDotFormat(const QString& dotContent) {
     // Clear the existing graph before parsing
     clear();
     
-    // Use QRegularExpression instead of QRegExp (more powerful and less deprecated)
-    // Node pattern: match both numbered nodes and named nodes
-    QRegularExpression nodeRegex("\\s*(\\d+|\"[^\"]+\")\\s*\\[\\s*([^\\]]+)\\]\\s*;?");
-    
-    // Edge pattern: handle various edge formats
-    QRegularExpression edgeRegex("\\s*(\\d+|\"[^\"]+\")\\s*->\\s*(\\d+|\"[^\"]+\")\\s*(?:\\[\\s*([^\\]]+)\\])?\\s*;?");
-    
-    // Attribute pattern: handles both quoted and unquoted values
-    QRegularExpression attrRegex("(\\w+)\\s*=\\s*(?:\"([^\"]*)\"|([^\\s,;\"]+))");
-    
-    // Global attribute pattern: e.g., "node [shape=box];"
-    QRegularExpression globalAttrRegex("\\s*(graph|node|edge)\\s*\\[\\s*([^\\]]+)\\]\\s*;?");
-    
-    QMap<QString, QMap<QString, QString>> defaultAttributes;
-    defaultAttributes["node"]["shape"] = "ellipse";
-    defaultAttributes["node"]["style"] = "filled";
-    defaultAttributes["node"]["fillcolor"] = "lightgray";
-    defaultAttributes["edge"]["color"] = "black";
-    
-    if (!nodeRegex.isValid() || !edgeRegex.isValid() || !attrRegex.isValid() || !globalAttrRegex.isValid()) {
-        qCritical() << "Invalid regular expression patterns";
-        return false;
-    }
-    
-    bool parsedSuccessfully = false;
-    QStringList lines = dotContent.split('\n', Qt::SkipEmptyParts);
-    
-    // Debug: print first few lines of DOT content
-    qDebug() << "DOT content sample:" << dotContent.left(200);
-    
-    for (const QString& line : lines) {
-        QString trimmed = line.trimmed();
-        
-        // Skip comments and graph declarations
-        if (trimmed.startsWith("//") || trimmed.startsWith("#") || trimmed.isEmpty() ||
-            trimmed.startsWith("digraph") || trimmed.startsWith("graph") || 
-            trimmed == "{" || trimmed == "}") {
-            qDebug() << "Skipping line:" << trimmed;
-            continue;
+    // Creates scene items as the reader reports statements. Numeric IDs are used as
+    // they are; other IDs get negative ones so they cannot collide.
+    class SceneBuilder : public DotReader::Handler {
+    public:
+        explicit SceneBuilder(CustomGraphView& view) : m_view(view) {
+            m_defaults["node"]["shape"] = "ellipse";
+            m_defaults["node"]["style"] = "filled";
+            m_defaults["node"]["fillcolor"] = "lightgray";
+            m_defaults["edge"]["color"] = "black";
         }
-        
-        // Check for global attribute settings
-        QRegularExpressionMatch globalAttrMatch = globalAttrRegex.match(trimmed);
-        if (globalAttrMatch.hasMatch()) {
-            QString elementType = globalAttrMatch.captured(1); // node, edge, or graph
-            QString attrStr = globalAttrMatch.captured(2);
-            
-            // Parse the attributes
-            QRegularExpressionMatchIterator attrMatches = attrRegex.globalMatch(attrStr);
-            while (attrMatches.hasNext()) {
-                QRegularExpressionMatch match = attrMatches.next();
-                QString key = match.captured(1);
-                QString value = match.captured(2);
-                if (value.isEmpty()) value = match.captured(3); // Non-quoted value
-                defaultAttributes[elementType][key] = value;
-            }
-            
-            qDebug() << "Set default" << elementType << "attributes:" << defaultAttributes[elementType];
-            parsedSuccessfully = true;
-            continue;
+
+        void defaults(DotReader::DefaultsKind kind, const DotReader::Attributes& attributes) override {
+            static const char* const kinds[] = {"graph", "node", "edge"};
+            merge(m_defaults[kinds[static_cast<int>(kind)]], attributes);
+            m_parsed = true;
         }
-        
-        // Try to match node pattern
-        QRegularExpressionMatch nodeMatch = nodeRegex.match(trimmed);
-        if (nodeMatch.hasMatch()) {
-            QString idStr = nodeMatch.captured(1);
-            // Strip quotes if present
-            if (idStr.startsWith("\"") && idStr.endsWith("\"")) {
-                idStr = idStr.mid(1, idStr.length() - 2);
-            }
-            int id = idStr.toInt();
-            
-            QString attrStr = nodeMatch.captured(2);
-            
-            // Parse attributes, starting with defaults
-            QMap<QString, QString> attributes = defaultAttributes["node"];
-            QRegularExpressionMatchIterator attrMatches = attrRegex.globalMatch(attrStr);
-            while (attrMatches.hasNext()) {
-                QRegularExpressionMatch match = attrMatches.next();
-                QString key = match.captured(1);
-                QString value = match.captured(2);
-                if (value.isEmpty()) value = match.captured(3); // Non-quoted value
-                attributes[key] = value;
-            }
-            
-            // Get label or use node ID as label
-            QString label = attributes.value("label", idStr);
-            if (label.startsWith("\"") && label.endsWith("\"")) {
-                label = label.mid(1, label.length() - 2);
-            }
-            
-            createNodeFromDot(id, label, attributes);
-            qDebug() << "Created node:" << id << "with label:" << label;
-            parsedSuccessfully = true;
-            continue;
+
+        void node(std::string_view id, const DotReader::Attributes& attributes) override {
+            int nodeId = idFor(id);
+            if (m_view.m_nodesMap.contains(nodeId)) return;
+
+            QMap<QString, QString> merged = m_defaults["node"];
+            merge(merged, attributes);
+            QString label = merged.value("label", toQString(id));
+            m_view.createNodeFromDot(nodeId, label, merged);
+            m_parsed = true;
         }
-        
-        // Try to match edge pattern
-        QRegularExpressionMatch edgeMatch = edgeRegex.match(trimmed);
-        if (edgeMatch.hasMatch()) {
-            QString sourceStr = edgeMatch.captured(1);
-            QString targetStr = edgeMatch.captured(2);
-            
-            // Strip quotes if present
-            if (sourceStr.startsWith("\"") && sourceStr.endsWith("\"")) {
-                sourceStr = sourceStr.mid(1, sourceStr.length() - 2);
-            }
-            if (targetStr.startsWith("\"") && targetStr.endsWith("\"")) {
-                targetStr = targetStr.mid(1, targetStr.length() - 2);
-            }
-            
-            int source = sourceStr.toInt();
-            int target = targetStr.toInt();
-            
-            QString attrStr = edgeMatch.captured(3);
-            
-            // Parse attributes, starting with defaults
-            QMap<QString, QString> attributes = defaultAttributes["edge"];
-            if (!attrStr.isEmpty()) {
-                QRegularExpressionMatchIterator attrMatches = attrRegex.globalMatch(attrStr);
-                while (attrMatches.hasNext()) {
-                    QRegularExpressionMatch match = attrMatches.next();
-                    QString key = match.captured(1);
-                    QString value = match.captured(2);
-                    if (value.isEmpty()) value = match.captured(3); // Non-quoted value
-                    attributes[key] = value;
-                }
+
+        void edge(std::string_view from, std::string_view to,
+                  const DotReader::Attributes& attributes) override {
+            int source = idFor(from);
+            int target = idFor(to);
+            // Endpoints without a node statement of their own
+            if (!m_view.m_nodesMap.contains(source)) node(from, {});
+            if (!m_view.m_nodesMap.contains(target)) node(to, {});
+
+            QMap<QString, QString> merged = m_defaults["edge"];
+            merge(merged, attributes);
+            m_view.createEdgeFromDot(source, target, merged);
+            m_parsed = true;
+        }
+
+        bool parsed() const { return m_parsed; }
+
+    private:
+        static QString toQString(std::string_view text) {
+            return QString::fromUtf8(text.data(), static_cast<int>(text.size()));
+        }
+
+        static void merge(QMap<QString, QString>& target, const DotReader::Attributes& attributes) {
+            for (const auto& attribute : attributes) {
+                QString value = toQString(attribute.name == "label"
+                                              ? DotReader::unescapeLabel(attribute.value)
+                                              : std::string(attribute.value));
+                target[toQString(attribute.name)] = value;
             }
-            
-            createEdgeFromDot(source, target, attributes);
-            qDebug() << "Created edge from" << source << "to" << target;
-            parsedSuccessfully = true;
-            continue;
         }
-        
-        qDebug() << "Unmatched line:" << trimmed;
+
+        // Named IDs, and negative numerals with them, get synthetic negative IDs, so
+        // they never collide with a literal ID
+        int idFor(std::string_view id) {
+            int number;
+            if (DotReader::toInt(id, number) && number >= 0) return number;
+
+            auto it = m_namedIds.find(std::string(id));
+            if (it != m_namedIds.end()) return it->second;
+            int assigned = -static_cast<int>(m_namedIds.size()) - 1;
+            m_namedIds.emplace(std::string(id), assigned);
+            return assigned;
+        }
+
+        CustomGraphView& m_view;
+        QMap<QString, QMap<QString, QString>> m_defaults;
+        std::unordered_map<std::string, int> m_namedIds;
+        bool m_parsed = false;
+    };
+
+    SceneBuilder builder(*this);
+    DotReader reader;
+    if (!reader.parse(dotContent, builder)) {
+        qWarning() << "DOT parse error:" << QString::fromStdString(reader.error());
     }
-    
-    if (parsedSuccessfully) {
-        qDebug() << "Successfully parsed DOT content";
+
+    if (builder.parsed()) {
         // Update scene bounds
         scene()->setSceneRect(scene()->itemsBoundingRect().adjusted(-20, -20, 20, 20));
     } else {
         qWarning() << "Failed to parse any valid nodes or edges from DOT content";
     }
     
-    return parsedSuccessfully;
+    return builder.parsed();
 }
 
 QMap<QString, QString> CustomGraphView::parseAttributes(const QString& attrStr) {
@@ -582,6 +607,7 @@ QMap<QString, QString> CustomGraphView::parseAttributes(const QString& attrStr)
 
 void CustomGraphView::createNodeFromDot(int id, const QString& label, const QMap<QString, QString>& attributes) {
     QGraphicsEllipseItem* node = new QGraphicsEllipseItem(-20, -20, 40, 40);
+    node->setData(0, QString::number(id));
     node->setData(MainWindow::NodeItemType, 1);
     
     // Apply attributes
@@ -590,16 +616,18 @@ void CustomGraphView::createNodeFromDot(int id, const QString& label, const QMap
     }
     
     // Add label
-    QGraphicsTextItem* text = new QGraphicsTextItem(label, node);
+    QGraphicsTextItem* text = new QGraphicsTextItem(node);
+    setLabelText(text, label);
     text->setPos(-15, -15);
     
     scene()->addItem(node);
+    m_nodesMap[id] = node;
 }
 
 void CustomGraphView::createEdgeFromDot(int source, int target, const QMap<QString, QString>& attributes) {
-    // Find source and target nodes in scene
-    QGraphicsItem* sourceItem = findNodeById(source);
-    QGraphicsItem* targetItem = findNodeById(target);
+    // Map lookup; scanning the scene per edge is quadratic on large graphs
+    QGraphicsItem* sourceItem = m_nodesMap.value(source);
+    QGraphicsItem* targetItem = m_nodesMap.value(target);
     
     if (sourceItem && targetItem) {
         QLineF line(sourceItem->sceneBoundingRect().center(),
@@ -670,9 +698,51 @@ void CustomGraphView::mouseMoveEvent(QMouseEvent *event)
         event->accept();
         return;
     }
+
+    // Cut labels are only laid out in full when hovered
+    if (m_maxLabelLength > 0) {
+        QString fullLabel = fullLabelAt(event->pos());
+        if (!fullLabel.isEmpty()) {
+            QToolTip::showText(event->globalPos(), fullLabel, this);
+            m_labelToolTipShown = true;
+        } else if (m_labelToolTipShown) {
+            QToolTip::hideText();
+            m_labelToolTipShown = false;
+        }
+    }
     QGraphicsView::mouseMoveEvent(event);
 }
 
+void CustomGraphView::setMaxLabelLength(int length)
+{
+    m_maxLabelLength = qMax(0, length);
+}
+
+void CustomGraphView::setLabelText(QGraphicsTextItem* item, const QString& label)
+{
+    if (m_maxLabelLength > 0 && label.size() > m_maxLabelLength) {
+        item->setPlainText(label.left(m_maxLabelLength - 1) + QChar(0x2026));
+        item->setData(FullLabelKey, label);
+    } else {
+        item->setPlainText(label);
+    }
+}
+
+QString CustomGraphView::fullLabelAt(const QPoint& pos) const
+{
+    for (QGraphicsItem* item : items(pos)) {
+        QVariant fullLabel = item->data(FullLabelKey);
+        if (fullLabel.isValid()) return fullLabel.toString();
+
+        // Hovering a node's shape rather than its text
+        for (QGraphicsItem* child : item->childItems()) {
+            fullLabel = child->data(FullLabelKey);
+            if (fullLabel.isValid()) return fullLabel.toString();
+        }
+    }
+    return QString();
+}
+
 void CustomGraphView::highlightFunction(const QString& functionName)
 {
     // First reset all highlights
@@ -776,62 +846,19 @@ void CustomGraphView::toggleGraphDisplay(bool showFullGraph) {
 }
 
 void CustomGraphView::parseJson(const QByteArray &jsonData) {
-    clear();
-    
-    QJsonDocument doc = QJsonDocument::fromJson(jsonData);
-    if (doc.isNull()) {
-        qWarning() << "Invalid JSON data";
+    // Read straight into a graph; no QJsonDocument tree in between
+    GraphGenerator::CFGGraph graph;
+    std::string error;
+    if (!GraphGenerator::readJsonCFG(std::string_view(jsonData.constData(), static_cast<size_t>(jsonData.size())),
+                                     graph, 0, &error)) {
+        qWarning() << "Invalid JSON data:" << QString::fromStdString(error);
         return;
     }
-    
-    QJsonObject json = doc.object();
-    QMap<QString, QGraphicsEllipseItem*> nodeItems;
-    
-    // Create nodes
-    QJsonArray nodes = json["nodes"].toArray();
-    for (const QJsonValue &node : nodes) {
-        QJsonObject nodeObj = node.toObject();
-        QString id = nodeObj["id"].toString();
-        QString label = nodeObj["label"].toString();
-        
-        QGraphicsEllipseItem* ellipse = m_scene->addEllipse(0, 0, 80, 40, 
-                                                          QPen(Qt::black), 
-                                                          QBrush(Qt::lightGray));
-        QGraphicsTextItem* text = m_scene->addText(label);
-        text->setPos(10, 5);
-        
-        // Simple layout - arrange in grid
-        int idx = nodeItems.size();
-        int row = idx / 5;
-        int col = idx % 5;
-        ellipse->setPos(col * 150, row * 100);
-        text->setPos(col * 150 + 10, row * 100 + 5);
-        
-        nodeItems[id] = ellipse;
-        m_nodes[id] = ellipse; // Store in main nodes map
-    }
-    
-    // Create edges
-    QJsonArray edges = json["edges"].toArray();
-    for (const QJsonValue &edge : edges) {
-        QJsonObject edgeObj = edge.toObject();
-        QString from = edgeObj["from"].toString();
-        QString to = edgeObj["to"].toString();
-        
-        if (nodeItems.contains(from) && nodeItems.contains(to)) {
-            QGraphicsEllipseItem* fromItem = nodeItems[from];
-            QGraphicsEllipseItem* toItem = nodeItems[to];
-            
-            QLineF line(fromItem->rect().center() + fromItem->pos(),
-                       toItem->rect().center() + toItem->pos());
-            QGraphicsLineItem* edgeItem = m_scene->addLine(line, QPen(Qt::black, 1.5));
-            edgeItem->setData(0, "edge");  // Mark as edge
-            edgeItem->setData(1, from);    // Store source
-            edgeItem->setData(2, to);      // Store target
-            m_edges.append(qMakePair(from, to)); // Store relationship
-        }
+    if (graph.getNodeCount() == 0) {
+        return;  // not a CFG document, e.g. the analyzer's function list
     }
-    
+
+    displayCFG(graph);
     fitInView(m_scene->itemsBoundingRect(), Qt::KeepAspectRatio);
 }
 
@@ -856,6 +883,7 @@ void CustomGraphView::clear()
         m_scene->clear();
     }
     m_nodes.clear();
+    m_nodesMap.clear();
     m_edges.clear();
     m_nodeLevels.clear();
     
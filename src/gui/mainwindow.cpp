@@ -2,9 +2,14 @@
 #include "cfg_analyzer.h"
 #include "ui_mainwindow.h"
 #include "visualizer.h"
+#include "compile_commands.h"
+#include "cfg_registry.h"
+#include "cfg_json_reader.h"
+#include "dot_reader.h"
 #include <QFileDialog>
 #include <QMessageBox>
 #include <QFile>
+#include <QFileInfo>
 #include <QJsonDocument>
 #include <QJsonArray>
 #include <QJsonObject>
@@ -36,6 +41,7 @@
 
 const int MainWindow::NodeItemType = QGraphicsItem::UserType + 1;
 const int MainWindow::EdgeItemType = QGraphicsItem::UserType + 2;
+const int MainWindow::MaxNodeLabelLength = 120;
 const QString MainWindow::NodeTypeKey = "NodeType";
 const QString MainWindow::EdgeTypeKey = "EdgeType";
 
@@ -85,6 +91,7 @@ MainWindow::MainWindow(QWidget *parent) :
     connect(ui->browseButton, &QPushButton::clicked, this, &MainWindow::on_browseButton_clicked);
     connect(ui->analyzeButton, &QPushButton::clicked, this, &MainWindow::on_analyzeButton_clicked);
     connect(ui->openFilesButton, &QPushButton::clicked, this, &MainWindow::on_openFilesButton_clicked);
+    connect(ui->analyzeAllButton, &QPushButton::clicked, this, &MainWindow::on_analyzeAllButton_clicked);
     connect(ui->searchButton, &QPushButton::clicked, this, &MainWindow::on_searchButton_clicked);
     connect(ui->toggleFunctionGraph, &QPushButton::clicked, this, &MainWindow::on_toggleFunctionGraph_clicked);
     connect(ui->fileList, &QListWidget::itemClicked, this, &MainWindow::on_fileList_itemClicked);
@@ -93,6 +100,23 @@ MainWindow::MainWindow(QWidget *parent) :
 
     connect(ui->extractAstButton, &QPushButton::clicked, 
             this, &MainWindow::on_extractAstButton_clicked);
+    connect(ui->actionLoadCompileCommands, &QAction::triggered,
+            this, &MainWindow::on_loadCompileCommands_triggered);
+    connect(ui->actionAnalyzeProject, &QAction::triggered,
+            this, &MainWindow::on_analyzeProject_triggered);
+    connect(ui->actionWatchFiles, &QAction::toggled,
+            this, &MainWindow::on_watchFiles_toggled);
+
+    // Editors often write a file several times per save, so changes are batched
+    m_watcher = new QFileSystemWatcher(this);
+    m_watchTimer = new QTimer(this);
+    m_watchTimer->setSingleShot(true);
+    m_watchTimer->setInterval(300);
+    connect(m_watcher, &QFileSystemWatcher::fileChanged, this, &MainWindow::onWatchedFileChanged);
+    connect(m_watchTimer, &QTimer::timeout, this, &MainWindow::reanalyzeChangedFiles);
+
+    // Unchanged header CFGs written by earlier sessions are not rewritten
+    CFGOutputIndex::instance().setIndexFile("cfg_output/.cfg_index");
 
     // Initial UI state
     setUiEnabled(true);
@@ -128,6 +152,7 @@ bool MainWindow::tryInitializeView(bool tryHardware) {
         
         // 2. Configure view based on rendering mode
         m_graphView = new CustomGraphView(centralWidget());
+        m_graphView->setMaxLabelLength(MaxNodeLabelLength);
         
         if (tryHardware) {
             m_graphView->setViewport(new QOpenGLWidget());
@@ -177,7 +202,7 @@ void MainWindow::startTextOnlyMode() {
     // Connect to the analysisComplete signal
     connect(this, &MainWindow::analysisComplete, this, 
         [this](const CFGAnalyzer::AnalysisResult& result) {
-            ui->reportTextEdit->setPlainText(QString::fromStdString(result.dotOutput));
+            ui->reportTextEdit->setPlainText(QString::fromStdString(result.report));
         });
 }
 
@@ -279,6 +304,7 @@ void MainWindow::setupGraphView()
 
     // 3. Configure view with software rendering
     m_graphView = new CustomGraphView(centralWidget());
+    m_graphView->setMaxLabelLength(MaxNodeLabelLength);
     m_graphView->setViewport(new QWidget()); // Force software
     m_graphView->setScene(m_scene); // This sets both QGraphicsView's scene and CustomGraphView's m_scene
     m_graphView->setRenderHint(QPainter::Antialiasing, false);
@@ -294,7 +320,7 @@ void MainWindow::setupGraphView()
     qDebug() << "Viewport type:" << m_graphView->viewport()->metaObject()->className();
 }
 
-void MainWindow::visualizeCFG(std::shared_ptr<GraphGenerator::CFGGraph> graph)
+void MainWindow::visualizeCFG(std::shared_ptr<const GraphGenerator::CFGGraph> graph)
 {
     if (!graph) {
         qWarning() << "Null CFGGraph provided!";
@@ -309,12 +335,8 @@ void MainWindow::visualizeCFG(std::shared_ptr<GraphGenerator::CFGGraph> graph)
     }
 
     try {
-        std::string dotContent = Visualizer::generateDotRepresentation(graph.get());
-        QString qDotContent = QString::fromStdString(dotContent);
-        
-        if (!m_graphView->parseDotFormat(qDotContent)) {
-            throw std::runtime_error("Failed to parse DOT content");
-        }
+        // The view reads the graph directly; no DOT round trip
+        m_graphView->displayCFG(*graph);
 
         // Store the graph
         m_currentGraph = graph;
@@ -333,158 +355,116 @@ void MainWindow::visualizeCFG(std::shared_ptr<GraphGenerator::CFGGraph> graph)
     }
 }
 
-std::shared_ptr<GraphGenerator::CFGGraph> MainWindow::parseDotToCFG(const QString& dotContent)
+std::shared_ptr<GraphGenerator::CFGGraph> MainWindow::parseDotToCFG(std::string_view dotContent)
 {
-    auto graph = std::make_shared<GraphGenerator::CFGGraph>();
-        
-    // Initialize regular expressions with properly escaped patterns
-    QRegularExpression nodeRegex(R"(^\s*(\d+)\s*\[([^\]]*)\]\s*;?\s*$)");
-    QRegularExpression edgeRegex(R"(^\s*(\d+)\s*->\s*(\d+)\s*\[([^\]]*)\]\s*;?\s*$)");
-    QRegularExpression labelRegex(R"~(label\s*=\\s*"([^"]*)")~");
-    QRegularExpression colorRegex(R"~(color\s*=\s*"?(red|blue|green|black|white|gray)"?)~");
-    QRegularExpression shapeRegex(R"~(shape\s*=\s*"?(box|ellipse|diamond|circle)"?)~");
-
-    // Verify regex validity
-    auto checkRegex = [](const QRegularExpression& re, const QString& name) {
-        if (!re.isValid()) {
-            qCritical() << "Invalid" << name << "regex:" << re.errorString() << "Pattern:" << re.pattern();
-            return false;
-        }
-        return true;
-    };
-
-    if (!checkRegex(nodeRegex, "node") || 
-        !checkRegex(edgeRegex, "edge") ||
-        !checkRegex(labelRegex, "label") ||
-        !checkRegex(colorRegex, "color") ||
-        !checkRegex(shapeRegex, "shape")) {
-        return graph;
-    }
-
-    // Split and process DOT content
-    QStringList lines = dotContent.split('\n', Qt::SkipEmptyParts);
-    
-    for (const QString& line : lines) {
-        QString trimmed = line.trimmed();
-        
-        // Skip comments and graph declarations
-        if (trimmed.startsWith("//") || trimmed.startsWith("/*") || 
-            trimmed.startsWith("digraph") || trimmed.startsWith("}") || 
-            trimmed.isEmpty()) {
-            continue;
-        }
-        
-        // Parse node
-        auto nodeMatch = nodeRegex.match(trimmed);
-        if (nodeMatch.hasMatch()) {
-            bool ok;
-            int id = nodeMatch.captured(1).toInt(&ok);
-            if (!ok) continue;
-            
-            graph->addNode(id);
-            
-            QString attributes = nodeMatch.captured(2);
-            auto labelMatch = labelRegex.match(attributes);
-            if (labelMatch.hasMatch()) {
-                graph->addStatement(id, labelMatch.captured(1).toStdString());
+    // Numeric node IDs become blocks; red marks throwing blocks and exception edges,
+    // box marks try blocks. Only a statement's own attributes count, as before.
+    class CFGBuilder : public DotReader::Handler {
+    public:
+        explicit CFGBuilder(GraphGenerator::CFGGraph& graph) : m_graph(graph) {}
+
+        void node(std::string_view id, const DotReader::Attributes& attributes) override {
+            int nodeId;
+            if (!DotReader::toInt(id, nodeId)) return;
+
+            m_graph.addNode(nodeId);
+            std::string_view label = DotReader::find(attributes, "label");
+            if (!label.empty()) {
+                m_graph.addStatement(nodeId, DotReader::unescapeLabel(label));
             }
-            
-            auto colorMatch = colorRegex.match(attributes);
-            if (colorMatch.hasMatch() && colorMatch.captured(1) == "red") {
-                graph->markNodeAsThrowingException(id);
+            if (DotReader::find(attributes, "color") == "red") {
+                m_graph.markNodeAsThrowingException(nodeId);
             }
-            
-            auto shapeMatch = shapeRegex.match(attributes);
-            if (shapeMatch.hasMatch() && shapeMatch.captured(1) == "box") {
-                graph->markNodeAsTryBlock(id);
+            if (DotReader::find(attributes, "shape") == "box") {
+                m_graph.markNodeAsTryBlock(nodeId);
             }
-            continue;
         }
-        
-        // Parse edge
-        auto edgeMatch = edgeRegex.match(trimmed);
-        if (edgeMatch.hasMatch()) {
-            bool ok1, ok2;
-            int fromId = edgeMatch.captured(1).toInt(&ok1);
-            int toId = edgeMatch.captured(2).toInt(&ok2);
-            if (!ok1 || !ok2) continue;
-            
-            graph->addEdge(fromId, toId);
-            
-            QString attributes = edgeMatch.captured(3);
-            auto colorMatch = colorRegex.match(attributes);
-            if (colorMatch.hasMatch() && colorMatch.captured(1) == "red") {
-                graph->addExceptionEdge(fromId, toId);
+
+        void edge(std::string_view from, std::string_view to,
+                  const DotReader::Attributes& attributes) override {
+            int fromId, toId;
+            if (!DotReader::toInt(from, fromId) || !DotReader::toInt(to, toId)) {
+                return;
+            }
+
+            m_graph.addEdge(fromId, toId);
+            if (DotReader::find(attributes, "color") == "red") {
+                m_graph.addExceptionEdge(fromId, toId);
             }
         }
+
+    private:
+        GraphGenerator::CFGGraph& m_graph;
+    };
+
+    auto graph = std::make_shared<GraphGenerator::CFGGraph>();
+    CFGBuilder builder(*graph);
+    DotReader reader;
+    if (!reader.parse(dotContent, builder)) {
+        qWarning() << "DOT parse error:" << QString::fromStdString(reader.error());
     }
-    
     return graph;
 }
 
-void MainWindow::loadAndProcessJson(const QString& filePath) 
+bool MainWindow::loadAndProcessJson(const QString& filePath) 
 {
     // Verify file exists
     if (!QFile::exists(filePath)) {
         qWarning() << "JSON file does not exist:" << filePath;
         QMessageBox::warning(this, "Error", "JSON file not found: " + filePath);
-        return;
+        return false;
     }
 
-    QFile file(filePath);
-    if (!file.open(QIODevice::ReadOnly)) {
-        qWarning() << "Could not open JSON file:" << file.errorString();
-        QMessageBox::warning(this, "Error", "Could not open JSON file: " + file.errorString());
-        return;
+    // One streaming pass over the mapped file straight into the graph the view shows
+    auto graph = std::make_shared<GraphGenerator::CFGGraph>();
+    std::string error;
+    if (!GraphGenerator::readJsonCFGFile(filePath.toStdString(), *graph, 0, &error)) {
+        QMessageBox::warning(this, "JSON Error", "Could not load JSON file: " + QString::fromStdString(error));
+        return false;
     }
 
-    // Read and parse JSON
-    QJsonParseError parseError;
-    QByteArray jsonData = file.readAll();
-    QJsonDocument doc = QJsonDocument::fromJson(jsonData, &parseError);
-    
-    if (parseError.error != QJsonParseError::NoError) {
-        qWarning() << "JSON parse error at offset" << parseError.offset << ":" << parseError.errorString();
-        QMessageBox::warning(this, "JSON Error", 
-                           QString("Parse error at position %1: %2")
-                           .arg(parseError.offset)
-                           .arg(parseError.errorString()));
+    m_currentFunction.clear();
+    m_currentUsr.clear();
+    visualizeCFG(graph);
+    statusBar()->showMessage("JSON loaded successfully", 3000);
+    return true;
+}
+
+void MainWindow::loadBinaryCFG(const QString& filePath)
+{
+    std::string error;
+    auto file = GraphGenerator::BinaryCFGFile::open(filePath.toStdString(), &error);
+    if (!file) {
+        QMessageBox::warning(this, "Error", "Could not load CFG file: " + QString::fromStdString(error));
         return;
     }
+    m_binaryCFGs = file;
 
-    if (doc.isNull()) {
-        qWarning() << "Invalid JSON document";
-        QMessageBox::warning(this, "Error", "Invalid JSON document");
-        return;
+    // Nothing is read up front; a function's nodes are only touched when it is shown
+    ui->reportTextEdit->setPlainText(QString("%1: %2 functions, %3 blocks, %4 edges")
+        .arg(filePath).arg(file->functionCount()).arg(file->nodeCount()).arg(file->edgeCount()));
+    if (file->functionCount() > 0) {
+        std::string_view name = file->functionName(0);
+        m_currentFunction = QString::fromUtf8(name.data(), static_cast<int>(name.size()));
+        m_currentUsr.clear();
+        visualizeCFG(file->toGraph(0));
     }
+    statusBar()->showMessage("Loaded " + filePath + " - search for a function to show it", 3000);
+}
 
-    // Process the JSON data
-    try {
-        QJsonObject jsonObj = doc.object();
-        
-        // Example processing - adapt to your needs
-        if (jsonObj.contains("nodes") && jsonObj["nodes"].isArray()) {
-            QJsonArray nodes = jsonObj["nodes"].toArray();
-            for (const QJsonValue& node : nodes) {
-                if (node.isObject()) {
-                    QJsonObject nodeObj = node.toObject();
-                    // Process each node
-                }
-            }
-        }
-        
-        // Update UI or visualization
-        QMetaObject::invokeMethod(this, [this, jsonObj]() {
-            // Update your graph view here
-            m_graphView->parseJson(QJsonDocument(jsonObj).toJson());
-            statusBar()->showMessage("JSON loaded successfully", 3000);
-        });
-        
-    } catch (const std::exception& e) {
-        qCritical() << "JSON processing error:" << e.what();
-        QMessageBox::critical(this, "Processing Error", 
-                            QString("Error processing JSON: %1").arg(e.what()));
+void MainWindow::loadBundle(const QString& filePath)
+{
+    std::string error;
+    auto bundle = GraphGenerator::BundleFile::open(filePath.toStdString(), &error);
+    if (!bundle) {
+        QMessageBox::warning(this, "Error", "Could not load CFG bundle: " + QString::fromStdString(error));
+        return;
     }
+    m_bundle = bundle;
+
+    // Only the index is read here; an entry is read when its function is searched for
+    ui->reportTextEdit->setPlainText(QString("%1: %2 entries").arg(filePath).arg(bundle->entryCount()));
+    statusBar()->showMessage("Loaded " + filePath + " - search for a function to show it", 3000);
 }
 
 void MainWindow::initializeGraphviz()
@@ -517,25 +497,29 @@ void MainWindow::onParseButtonClicked()
 
     QFuture<void> future = QtConcurrent::run([this, filePath]() {
         try {
-            // Read file content
+            // Parse straight from the mapped file
             QFile file(filePath);
-            if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+            if (!file.open(QIODevice::ReadOnly)) {
                 throw std::runtime_error("Could not open file: " + filePath.toStdString());
             }
             
-            QString dotContent = file.readAll();
+            std::shared_ptr<GraphGenerator::CFGGraph> graph;
+            if (file.size() == 0) {
+                graph = std::make_shared<GraphGenerator::CFGGraph>();
+            } else if (uchar* data = file.map(0, file.size())) {
+                graph = parseDotToCFG(std::string_view(reinterpret_cast<const char*>(data),
+                                                       static_cast<size_t>(file.size())));
+                file.unmap(data);
+            } else {
+                QByteArray dotContent = file.readAll();
+                graph = parseDotToCFG(std::string_view(dotContent.constData(),
+                                                       static_cast<size_t>(dotContent.size())));
+            }
             file.close();
             
-            // Parse DOT content
-            auto graph = parseDotToCFG(dotContent); // graph is now shared_ptr
-            
             // Count nodes and edges
-            int nodeCount = 0;
-            int edgeCount = 0;
-            for (const auto& [id, node] : graph->getNodes()) {
-                nodeCount++;
-                edgeCount += node.successors.size();
-            }
+            int nodeCount = static_cast<int>(graph->getNodeCount());
+            int edgeCount = static_cast<int>(graph->getEdgeCount());
             
             QString report = QString("Parsed CFG from DOT file\n\n")
                            + QString("File: %1\n").arg(filePath)
@@ -642,10 +626,30 @@ void MainWindow::highlightFunction(const QString& functionName) {
 
 void MainWindow::exportGraph() {
     QString fileName = QFileDialog::getSaveFileName(this, "Export Graph",
-        "", "PNG Images (*.png);;PDF Files (*.pdf);;SVG Files (*.svg)");
+        "", "PNG Images (*.png);;PDF Files (*.pdf);;SVG Files (*.svg);;DOT Files (*.dot);;JSON Files (*.json)");
     
     if (fileName.isEmpty()) return;
 
+    // Text formats are written from the graph on display, only when asked for
+    if (fileName.endsWith(".dot") || fileName.endsWith(".json")) {
+        if (!m_currentGraph) {
+            QMessageBox::warning(this, "Export Error", "No graph to export");
+            return;
+        }
+        try {
+            if (fileName.endsWith(".dot")) {
+                m_currentGraph->writeToDotFile(fileName.toStdString());
+            } else {
+                m_currentGraph->writeToJsonFile(fileName.toStdString(),
+                                                GraphGenerator::json::object(),
+                                                GraphGenerator::json::array());
+            }
+        } catch (const std::exception& e) {
+            QMessageBox::warning(this, "Export Error", e.what());
+        }
+        return;
+    }
+
     if (fileName.endsWith(".png")) {
         QImage image(m_graphView->sceneRect().size().toSize(), QImage::Format_ARGB32);
         QPainter painter(&image);
@@ -698,11 +702,19 @@ void MainWindow::on_analyzeButton_clicked() {
     ui->reportTextEdit->clear();
     statusBar()->showMessage("Analyzing file...");
 
-    QFuture<void> future = QtConcurrent::run([this, filePath]() {
+    auto compilations = compilationsFor(filePath);
+    QFuture<void> future = QtConcurrent::run([this, filePath, compilations]() {
         try {
-            // Create analyzer instance with fully qualified name
+            // All actions on this file share the session's parse
+            std::string filename = filePath.toStdString();
+            auto session = CFGAnalyzer::AnalysisSession::forFile(filename);
             CFGAnalyzer::CFGAnalyzer analyzer;
-            auto result = analyzer.analyze(filePath.toStdString());
+            CFGAnalyzer::AnalysisResult result;
+            if (session->open(filename, compilations)) {
+                result = analyzer.analyze(*session);
+            } else {
+                result.report = "Failed to parse " + filename;
+            }
             
             // Update UI in main thread
             QMetaObject::invokeMethod(this, [this, result]() {
@@ -721,6 +733,215 @@ void MainWindow::on_analyzeButton_clicked() {
     });
 }
 
+std::shared_ptr<const clang::tooling::CompilationDatabase> MainWindow::compilationsFor(
+    const QString& filePath)
+{
+    // A database the user loaded applies to everything
+    if (m_compilations) {
+        return m_compilations;
+    }
+
+    // Otherwise the compile_commands.json of the file's own project, if there is one
+    std::string dbPath = CompileCommands::discover(filePath.toStdString());
+    if (dbPath.empty()) {
+        return nullptr;
+    }
+    auto known = m_discoveredCompilations.find(dbPath);
+    if (known != m_discoveredCompilations.end()) {
+        return known->second;
+    }
+
+    std::string error;
+    auto compilations = CompileCommands::load(dbPath, error);
+    if (!compilations) {
+        qWarning() << "Could not load" << dbPath.c_str() << ":" << error.c_str();
+        return nullptr;
+    }
+    qDebug() << "Using compilation database:" << dbPath.c_str();
+    m_discoveredCompilations.emplace(dbPath, compilations);
+    return compilations;
+}
+
+void MainWindow::on_loadCompileCommands_triggered()
+{
+    QString dbPath = QFileDialog::getOpenFileName(this, "Open Compilation Database",
+                                                  "", "Compilation Database (compile_commands.json)");
+    if (dbPath.isEmpty()) return;
+
+    std::string error;
+    auto compilations = CompileCommands::load(dbPath.toStdString(), error);
+    if (!compilations) {
+        QMessageBox::warning(this, "Error", 
+                             "Could not load compilation database: " + QString::fromStdString(error));
+        return;
+    }
+
+    m_compilations = compilations;
+    m_parser.setCompilationDatabase(compilations);
+
+    ui->fileList->clear();
+    for (const std::string& file : compilations->getAllFiles()) {
+        ui->fileList->addItem(QString::fromStdString(file));
+    }
+    statusBar()->showMessage("Loaded compilation database: " + dbPath, 3000);
+}
+
+void MainWindow::on_analyzeProject_triggered()
+{
+    if (!m_compilations) {
+        QMessageBox::warning(this, "Error", "Please load a compile_commands.json first");
+        return;
+    }
+
+    setUiEnabled(false);
+    ui->reportTextEdit->clear();
+    statusBar()->showMessage("Analyzing project...");
+
+    auto compilations = m_compilations;
+    QtConcurrent::run([this, compilations]() {
+        try {
+            CFGAnalyzer::CFGAnalyzer analyzer;
+            analyzer.setCompilationDatabase(compilations);
+            // One indexed file for the whole project instead of a DOT file per function
+            analyzer.setOutputBundle(std::string("cfg_output/project") + GraphGenerator::Bundle::FileSuffix);
+            auto result = analyzer.analyzeProject();
+
+            QMetaObject::invokeMethod(this, [this, result]() {
+                emit analysisComplete(result);
+                handleAnalysisResult(result);
+                setUiEnabled(true);
+            });
+        } catch (const std::exception& e) {
+            QMetaObject::invokeMethod(this, [this, e]() {
+                QMessageBox::critical(this, "Analysis Error",
+                                      QString("Project analysis failed: %1").arg(e.what()));
+                setUiEnabled(true);
+                statusBar()->showMessage("Analysis failed", 3000);
+            });
+        }
+    });
+}
+
+void MainWindow::on_watchFiles_toggled(bool enabled)
+{
+    if (!m_watcher->files().isEmpty()) {
+        m_watcher->removePaths(m_watcher->files());
+    }
+    m_changedFiles.clear();
+
+    if (!enabled) {
+        statusBar()->showMessage("Stopped watching files", 3000);
+        return;
+    }
+
+    QStringList files;
+    if (!ui->filePathEdit->text().isEmpty()) {
+        files << ui->filePathEdit->text();
+    }
+    for (int i = 0; i < ui->fileList->count(); ++i) {
+        files << ui->fileList->item(i)->text();
+    }
+    files.removeDuplicates();
+    if (files.isEmpty()) {
+        QMessageBox::warning(this, "Error", "Please select a file first");
+        ui->actionWatchFiles->setChecked(false);
+        return;
+    }
+
+    m_watcher->addPaths(files);
+
+    // First pass records the body hashes; later saves only rebuild what changed
+    for (const QString& file : files) {
+        m_changedFiles.insert(file);
+    }
+    reanalyzeChangedFiles();
+    statusBar()->showMessage(QString("Watching %1 files").arg(files.size()), 3000);
+}
+
+void MainWindow::onWatchedFileChanged(const QString& path)
+{
+    // Editors that save by renaming replace the file, which drops it from the watcher
+    if (QFile::exists(path) && !m_watcher->files().contains(path)) {
+        m_watcher->addPath(path);
+    }
+    m_changedFiles.insert(path);
+    m_watchTimer->start();
+}
+
+void MainWindow::reanalyzeChangedFiles()
+{
+    QSet<QString> changed;
+    changed.swap(m_changedFiles);
+
+    for (const QString& file : changed) {
+        if (!QFile::exists(file)) continue;
+        // One update per file at a time, so an older graph never overtakes a newer one;
+        // a change that comes in meanwhile is picked up when the running update is done
+        if (m_updatingFiles.contains(file)) {
+            m_changedFiles.insert(file);
+            continue;
+        }
+        m_updatingFiles.insert(file);
+
+        auto compilations = compilationsFor(file);
+        bool isCurrentFile = file == ui->filePathEdit->text();
+        QtConcurrent::run([this, file, compilations, isCurrentFile]() {
+            CFGAnalyzer::IncrementalAnalyzer::Update update;
+            std::string filename = file.toStdString();
+            // The current file's shared session is refreshed in place so other actions stay warm
+            auto session = isCurrentFile ? CFGAnalyzer::AnalysisSession::forFile(filename) : nullptr;
+            if (session && session->open(filename, compilations)) {
+                update = m_incremental.update(*session);
+            } else {
+                update = m_incremental.update(filename, compilations);
+            }
+
+            QMetaObject::invokeMethod(this, [this, file, update]() {
+                m_updatingFiles.remove(file);
+                applyIncrementalUpdate(update);
+                if (m_changedFiles.contains(file)) {
+                    m_watchTimer->start();
+                }
+            });
+        });
+    }
+}
+
+void MainWindow::applyIncrementalUpdate(const CFGAnalyzer::IncrementalAnalyzer::Update& update)
+{
+    QString file = QString::fromStdString(update.filename);
+    if (!update.success) {
+        statusBar()->showMessage("Re-analysis failed: " + file, 3000);
+        return;
+    }
+
+    ui->reportTextEdit->append(QString("%1: %2 changed, %3 removed, %4 unchanged")
+        .arg(file).arg(update.changed.size()).arg(update.removed.size()).arg(update.unchanged));
+
+    // Only the graph on display is redrawn, and only if its function changed. Without a
+    // USR the name has to be unambiguous, or an overload could replace it.
+    if (!m_currentUsr.empty()) {
+        auto it = update.changed.find(m_currentUsr);
+        if (it != update.changed.end()) {
+            visualizeCFG(it->second.graph);
+        }
+    } else if (!m_currentFunction.isEmpty()) {
+        std::string name = m_currentFunction.toStdString();
+        std::shared_ptr<GraphGenerator::CFGGraph> match;
+        size_t matches = 0;
+        for (const auto& [usr, function] : update.changed) {
+            if (function.name == name) {
+                match = function.graph;
+                ++matches;
+            }
+        }
+        if (matches == 1) {
+            visualizeCFG(match);
+        }
+    }
+    statusBar()->showMessage("Updated CFGs for " + file, 3000);
+}
+
 void MainWindow::handleAnalysisResult(const CFGAnalyzer::AnalysisResult& result) {
     if (!result.success) {
         ui->reportTextEdit->setPlainText(QString::fromStdString(result.report));
@@ -729,23 +950,17 @@ void MainWindow::handleAnalysisResult(const CFGAnalyzer::AnalysisResult& result)
         return;
     }
 
-    // Handle DOT output if available
-    if (!result.dotOutput.empty()) {
-        try {
-            auto graph = parseDotToCFG(QString::fromStdString(result.dotOutput));
-            m_currentGraph = graph; // Now using shared_ptr
-            visualizeCFG(graph);
-        } catch (...) {
-            qWarning() << "Failed to visualize CFG";
-        }
-    }
-
-    // Handle JSON output if available
-    if (!result.jsonOutput.empty()) {
-        m_graphView->parseJson(QString::fromStdString(result.jsonOutput).toUtf8());
+    // The analyzer's graphs are shown as they are; nothing is formatted or re-parsed
+    m_analysisCFGs = result.functionCFGs;
+    if (result.callGraph && result.callGraph->getNodeCount() > 0) {
+        m_currentFunction.clear();
+        m_currentUsr.clear();
+        visualizeCFG(result.callGraph);
     }
 
-    statusBar()->showMessage("Analysis completed", 3000);
+    statusBar()->showMessage(result.generatedAt.empty()
+        ? QString("Analysis completed")
+        : "Analysis completed at " + QString::fromStdString(result.generatedAt), 3000);
 }
 
 void MainWindow::on_extractAstButton_clicked() {
@@ -759,12 +974,26 @@ void MainWindow::on_extractAstButton_clicked() {
     ui->reportTextEdit->clear();
     statusBar()->showMessage("Extracting AST...");
 
-    QtConcurrent::run([this, filePath]() {
+    auto compilations = compilationsFor(filePath);
+    QtConcurrent::run([this, filePath, compilations]() {
         try {
-            // Create analyzer instance with fully qualified name
+            std::string filename = filePath.toStdString();
+            auto session = CFGAnalyzer::AnalysisSession::forFile(filename);
             CFGAnalyzer::CFGAnalyzer analyzer;
-            // Pass QString directly without conversion
-            auto result = analyzer.analyzeFile(filePath);
+            CFGAnalyzer::AnalysisResult result;
+            if (session->open(filename, compilations)) {
+                result = analyzer.analyzeFile(*session);
+            } else {
+                result.report = "Failed to parse " + filename;
+            }
+
+            // The AST dump comes from the same ASTContext as the CFGs
+            if (result.success) {
+                std::string astPath = "cfg_output/" + QFileInfo(filePath).completeBaseName().toStdString() + "_ast.json";
+                session->withContext([this, &astPath](clang::ASTContext& context) {
+                    m_astExtractor.extractAST(context, astPath);
+                });
+            }
             
             // Update UI in main thread
             QMetaObject::invokeMethod(this, [this, result]() {
@@ -805,8 +1034,8 @@ void MainWindow::displayFunctionInfo(const QString& input) {
             // Display statements if available
             if (!node.statements.empty()) {
                 ui->reportTextEdit->append("\nStatements:");
-                for (const auto& stmt : node.statements) {
-                    ui->reportTextEdit->append(QString::fromStdString(stmt));
+                for (std::string_view stmt : node.statements) {
+                    ui->reportTextEdit->append(QString::fromUtf8(stmt.data(), static_cast<int>(stmt.size())));
                 }
             }
             
@@ -847,6 +1076,40 @@ void MainWindow::on_searchButton_clicked()
         // First try to highlight existing nodes
         m_graphView->highlightFunction(searchText);
         
+        // Then a function CFG the last analysis already built
+        if (!m_graphView->hasHighlightedItems()) {
+            auto it = m_analysisCFGs.find(searchText.toStdString());
+            if (it != m_analysisCFGs.end()) {
+                m_currentFunction = searchText;
+                m_currentUsr.clear();
+                visualizeCFG(it->second);
+                return;
+            }
+        }
+
+        // Then a function from a loaded binary CFG file, if it has one by that name
+        if (!m_graphView->hasHighlightedItems() && m_binaryCFGs) {
+            int index = m_binaryCFGs->findFunction(searchText.toStdString());
+            if (index >= 0) {
+                m_currentFunction = searchText;
+                m_currentUsr.clear();
+                visualizeCFG(m_binaryCFGs->toGraph(index));
+                return;
+            }
+        }
+
+        // Then the first overload by that name in a loaded bundle
+        if (!m_graphView->hasHighlightedItems() && m_bundle) {
+            int index = m_bundle->find(searchText.toStdString(), GraphGenerator::Bundle::EntryKind::Dot);
+            std::string dot;
+            if (index >= 0 && m_bundle->read(index, dot)) {
+                m_currentFunction = searchText;
+                m_currentUsr.clear();
+                visualizeCFG(parseDotToCFG(dot));
+                return;
+            }
+        }
+
         // Then try to visualize the function if not found
         if (!m_graphView->hasHighlightedItems()) {
             visualizeFunction(searchText);
@@ -865,22 +1128,19 @@ void MainWindow::on_toggleFunctionGraph_clicked()
 void MainWindow::onLoadJsonClicked()
 {
     QString fileName = QFileDialog::getOpenFileName(this, "Open CFG JSON", 
-                                                  "", "JSON Files (*.json)");
-    if (!fileName.isEmpty()) {
-        QFile file(fileName);
-        if (file.open(QIODevice::ReadOnly)) {
-            QByteArray jsonData = file.readAll();
-            file.close();
-            
-            if (!m_loadedFiles.contains(fileName)) {
-                m_loadedFiles.append(fileName);
-                ui->fileList->addItem(fileName);
-            }
-            
-            m_graphView->parseJson(jsonData);
-            m_graphView->fitInView(m_graphView->scene()->itemsBoundingRect(), Qt::KeepAspectRatio);
-        } else {
-            QMessageBox::warning(this, "Error", "Could not open file: " + fileName);
+                                                  "", "CFG Files (*.json *.cfgb *.cfgbundle);;JSON Files (*.json);;Binary CFG Files (*.cfgb);;CFG Bundles (*.cfgbundle)");
+    if (fileName.endsWith(GraphGenerator::BinaryCFG::FileSuffix)) {
+        loadBinaryCFG(fileName);
+        return;
+    }
+    if (fileName.endsWith(GraphGenerator::Bundle::FileSuffix)) {
+        loadBundle(fileName);
+        return;
+    }
+    if (!fileName.isEmpty() && loadAndProcessJson(fileName)) {
+        if (!m_loadedFiles.contains(fileName)) {
+            m_loadedFiles.append(fileName);
+            ui->fileList->addItem(fileName);
         }
     }
 }
@@ -891,31 +1151,25 @@ void MainWindow::onMergeCfgsClicked() {
         return;
     }
     
-    QJsonObject mergedGraph;
-    QJsonArray nodes;
-    QJsonArray edges;
-    
+    // Each file is read into the same graph, its block IDs shifted past the ones
+    // already there so that blocks of different CFGs stay apart
+    auto merged = std::make_shared<GraphGenerator::CFGGraph>();
+    int nextId = 0;
     foreach (const QString &filePath, m_loadedFiles) {
-        QFile file(filePath);
-        if (file.open(QIODevice::ReadOnly)) {
-            QJsonDocument doc = QJsonDocument::fromJson(file.readAll());
-            file.close();
-            
-            if (!doc.isNull()) {
-                QJsonObject obj = doc.object();
-                nodes.append(obj["nodes"].toArray());
-                edges.append(obj["edges"].toArray());
-            }
+        std::string error;
+        if (!GraphGenerator::readJsonCFGFile(filePath.toStdString(), *merged, nextId, &error)) {
+            continue;
+        }
+        size_t count = merged->getNodeCount();
+        if (count > 0) {
+            nextId = merged->nodeView(count - 1).id + 1;  // nodes are in ID order
         }
     }
     
-    mergedGraph["nodes"] = nodes;
-    mergedGraph["edges"] = edges;
-    
     // Display merged graph
-    m_graphView->parseJson(QJsonDocument(mergedGraph).toJson());
-    m_graphView->fitInView(m_graphView->scene()->itemsBoundingRect(), 
-                         Qt::KeepAspectRatio);
+    m_currentFunction.clear();
+    m_currentUsr.clear();
+    visualizeCFG(merged);
 }
 
 void MainWindow::setGraphTheme(int theme)
@@ -993,11 +1247,17 @@ void MainWindow::visualizeFunction(const QString& functionName)
 
     setUiEnabled(false); // Disable UI during processing
     statusBar()->showMessage("Generating CFG for function...");
+    auto compilations = compilationsFor(filePath);
 
-    QtConcurrent::run([this, filePath, functionName]() {
+    QtConcurrent::run([this, filePath, functionName, compilations]() {
         try {
-            auto cfgGraph = generateFunctionCFG(filePath, functionName);
-            QMetaObject::invokeMethod(this, [this, cfgGraph]() {
+            QString qualifiedName;
+            std::string usr;
+            auto cfgGraph = generateFunctionCFG(filePath, functionName, compilations,
+                                                &qualifiedName, &usr);
+            QMetaObject::invokeMethod(this, [this, cfgGraph, qualifiedName, usr]() {
+                m_currentFunction = qualifiedName;
+                m_currentUsr = usr;
                 handleVisualizationResult(cfgGraph);
             });
         } catch (const std::exception& e) {
@@ -1009,51 +1269,36 @@ void MainWindow::visualizeFunction(const QString& functionName)
 }
 
 std::shared_ptr<GraphGenerator::CFGGraph> MainWindow::generateFunctionCFG(
-    const QString& filePath, const QString& functionName)
+    const QString& filePath, const QString& functionName,
+    std::shared_ptr<const clang::tooling::CompilationDatabase> compilations,
+    QString* qualifiedName, std::string* usr)
 {
     try {
-        // Create analyzer instance and use its public methods instead
-        CFGAnalyzer::CFGAnalyzer analyzer;
-        
-        // Use the public API to analyze the file - pass QString directly
-        auto result = analyzer.analyzeFile(filePath);
-        
-        if (!result.success) {
-            throw std::runtime_error("Failed to analyze file: " + result.report);
+        // The session keeps the AST between searches; only a changed file is re-parsed
+        auto session = CFGAnalyzer::AnalysisSession::forFile(filePath.toStdString());
+        if (!session->open(filePath.toStdString(), compilations)) {
+            throw std::runtime_error("Failed to parse file: " + filePath.toStdString());
         }
-        
-        // Create an empty CFG graph to start with
-        auto cfgGraph = std::make_shared<GraphGenerator::CFGGraph>();
-        
-        // For simplicity, we'll extract the graph from the DOT output
-        // if the analyzer provides it
-        if (!result.dotOutput.empty()) {
-            // Use our DOT parser to convert the DOT output to a CFG graph
-            cfgGraph = parseDotToCFG(QString::fromStdString(result.dotOutput));
-            
-            // Filter graph to only include the requested function
-            if (!functionName.isEmpty()) {
-                // We need to filter nodes to only include those from the function
-                // This is a simplified approach - the actual implementation
-                // might require more sophisticated filtering based on your graph structure
-                auto filteredGraph = std::make_shared<GraphGenerator::CFGGraph>();
-                
-                const auto& nodes = cfgGraph->getNodes();
-                for (const auto& [id, node] : nodes) {
-                    if (QString::fromStdString(node.functionName)
-                            .compare(functionName, Qt::CaseInsensitive) == 0) {
-                        // Copy this node and its edges to the filtered graph
-                        filteredGraph->addNode(id);
-                        for (int successor : node.successors) {
-                            filteredGraph->addEdge(id, successor);
-                        }
-                    }
-                }
-                
-                cfgGraph = filteredGraph;
-            }
+
+        auto matches = session->findFunctions(functionName.toStdString());
+        if (matches.empty()) {
+            throw std::runtime_error("Function not found: " + functionName.toStdString());
+        }
+        if (matches.size() > 1) {
+            qDebug() << matches.size() << "overloads of" << functionName
+                     << "- showing" << matches.front().signature.c_str();
+        }
+
+        auto cfgGraph = session->functionCFG(matches.front().usr);
+        if (!cfgGraph) {
+            throw std::runtime_error("Could not build CFG for " + matches.front().signature);
+        }
+        if (qualifiedName) {
+            *qualifiedName = QString::fromStdString(matches.front().name);
+        }
+        if (usr) {
+            *usr = matches.front().usr;
         }
-        
         return cfgGraph;
     }
     catch (const std::exception& e) {
@@ -1097,12 +1342,56 @@ void MainWindow::on_openFilesButton_clicked()
     }
 }
 
+void MainWindow::on_analyzeAllButton_clicked()
+{
+    std::vector<std::string> sources;
+    for (int i = 0; i < ui->fileList->count(); ++i) {
+        sources.push_back(ui->fileList->item(i)->text().toStdString());
+    }
+    if (sources.empty()) {
+        QMessageBox::warning(this, "Error", "Please open some files first");
+        return;
+    }
+
+    setUiEnabled(false);
+    ui->reportTextEdit->clear();
+    statusBar()->showMessage(QString("Analyzing %1 files...").arg(sources.size()));
+
+    auto compilations = compilationsFor(QString::fromStdString(sources.front()));
+    QtConcurrent::run([this, sources, compilations]() {
+        try {
+            CFGAnalyzer::CFGAnalyzer analyzer;
+            analyzer.setCompilationDatabase(compilations);
+            analyzer.setWorkerCount(QThread::idealThreadCount());
+            analyzer.setProgressCallback([this](const std::string&, bool, size_t done, size_t total) {
+                QMetaObject::invokeMethod(this, [this, done, total]() {
+                    statusBar()->showMessage(QString("Analyzed %1 of %2 files").arg(done).arg(total));
+                });
+            });
+            auto result = analyzer.analyzeFiles(sources);
+
+            QMetaObject::invokeMethod(this, [this, result]() {
+                emit analysisComplete(result);
+                handleAnalysisResult(result);
+                setUiEnabled(true);
+            });
+        } catch (const std::exception& e) {
+            QMetaObject::invokeMethod(this, [this, e]() {
+                QMessageBox::critical(this, "Analysis Error",
+                                      QString("Batch analysis failed: %1").arg(e.what()));
+                setUiEnabled(true);
+                statusBar()->showMessage("Analysis failed", 3000);
+            });
+        }
+    });
+}
+
 void MainWindow::setUiEnabled(bool enabled)
 {
     QList<QWidget*> widgets = {
         ui->browseButton, ui->analyzeButton, ui->openFilesButton,
         ui->searchButton, ui->toggleFunctionGraph, ui->fileList,
-        ui->loadJsonButton, ui->mergeCfgsButton
+        ui->loadJsonButton, ui->mergeCfgsButton, ui->analyzeAllButton
     };
     
     foreach (QWidget* widget, widgets) {
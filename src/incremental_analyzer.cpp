@@ -0,0 +1,91 @@
+#include "incremental_analyzer.h"
+#include "graph_generator.h"
+#include "output_writer.h"
+#include <llvm/Support/FileSystem.h>
+#include <unordered_set>
+
+namespace CFGAnalyzer {
+
+IncrementalAnalyzer::IncrementalAnalyzer(const std::string& outputDir)
+    : m_outputDir(outputDir) {}
+
+IncrementalAnalyzer::Update IncrementalAnalyzer::update(AnalysisSession& session) {
+    Update result;
+    result.filename = session.filename();
+    if (!session.isOpen()) {
+        return result;
+    }
+
+    if (!llvm::sys::fs::exists(m_outputDir)) {
+        llvm::sys::fs::create_directory(m_outputDir);
+    }
+
+    std::unordered_map<std::string, FunctionState> previous;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        previous = m_functions[result.filename];
+    }
+
+    std::unordered_map<std::string, FunctionState> current;
+    std::unordered_map<std::string, std::string> currentNames;  // name -> USR of its first overload
+    std::unordered_set<std::string> writtenNames;
+    for (const auto& function : session.functions()) {
+        current[function.usr] = {function.name, function.bodyHash};
+        currentNames.emplace(function.name, function.usr);
+
+        auto it = previous.find(function.usr);
+        if (it != previous.end() && it->second.bodyHash == function.bodyHash) {
+            ++result.unchanged;
+            continue;
+        }
+
+        auto graph = session.functionCFG(function.usr);
+        if (!graph) continue;
+        OutputWriter::instance().submitDot(m_outputDir + "/" + function.name + "_cfg.dot", graph);
+        writtenNames.insert(function.name);
+        result.changed[function.usr] = {function.name, graph};
+    }
+
+    for (const auto& [usr, state] : previous) {
+        if (current.count(usr)) continue;
+        result.removed[usr] = state.name;
+        if (!writtenNames.insert(state.name).second) continue;
+
+        // Overloads share one file: it goes with the last of them, and otherwise is
+        // rewritten from one that is left, as it may hold the removed one's graph
+        std::string path = m_outputDir + "/" + state.name + "_cfg.dot";
+        auto remaining = currentNames.find(state.name);
+        if (remaining == currentNames.end()) {
+            OutputWriter::instance().submitRemoval(path);
+        } else if (auto graph = session.functionCFG(remaining->second)) {
+            OutputWriter::instance().submitDot(path, graph);
+        }
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_functions[result.filename] = std::move(current);
+    }
+
+    result.success = true;
+    return result;
+}
+
+IncrementalAnalyzer::Update IncrementalAnalyzer::update(
+    const std::string& filename,
+    std::shared_ptr<const clang::tooling::CompilationDatabase> compilations) {
+    AnalysisSession session;
+    if (!session.open(filename, std::move(compilations))) {
+        Update result;
+        result.filename = filename;
+        return result;
+    }
+    return update(session);
+}
+
+void IncrementalAnalyzer::forget(const std::string& filename) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_functions.erase(filename);
+}
+
+} // namespace CFGAnalyzer
@@ -0,0 +1,255 @@
+#include "json_writer.h"
+#include <nlohmann/json.hpp>
+#include <charconv>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+
+namespace {
+
+    constexpr size_t FlushThreshold = 64 * 1024;
+
+    // Length of the valid UTF-8 sequence at text[i], 0 if it is not one
+    size_t utf8SequenceLength(std::string_view text, size_t i) {
+        auto byte = [&](size_t k) { return static_cast<unsigned char>(text[k]); };
+        auto continuation = [&](size_t k, unsigned char low, unsigned char high) {
+            return k < text.size() && byte(k) >= low && byte(k) <= high;
+        };
+
+        unsigned char lead = byte(i);
+        if (lead >= 0xC2 && lead <= 0xDF) {
+            return continuation(i + 1, 0x80, 0xBF) ? 2 : 0;
+        }
+        if (lead >= 0xE0 && lead <= 0xEF) {
+            unsigned char low = lead == 0xE0 ? 0xA0 : 0x80;
+            unsigned char high = lead == 0xED ? 0x9F : 0xBF;
+            return continuation(i + 1, low, high) && continuation(i + 2, 0x80, 0xBF) ? 3 : 0;
+        }
+        if (lead >= 0xF0 && lead <= 0xF4) {
+            unsigned char low = lead == 0xF0 ? 0x90 : 0x80;
+            unsigned char high = lead == 0xF4 ? 0x8F : 0xBF;
+            return continuation(i + 1, low, high) && continuation(i + 2, 0x80, 0xBF) &&
+                   continuation(i + 3, 0x80, 0xBF) ? 4 : 0;
+        }
+        return 0;
+    }
+
+} // namespace
+
+JsonWriter::JsonWriter(std::string& out, Style style, int indent)
+    : m_string(&out), m_style(style), m_indent(indent) {}
+
+JsonWriter::JsonWriter(std::ostream& out, Style style, int indent)
+    : m_stream(&out), m_style(style), m_indent(indent) {
+    m_buffer.reserve(FlushThreshold + 4096);
+}
+
+JsonWriter::~JsonWriter() {
+    flush();
+}
+
+bool JsonWriter::flush() {
+    if (m_stream) {
+        if (!m_buffer.empty()) {
+            m_stream->write(m_buffer.data(), static_cast<std::streamsize>(m_buffer.size()));
+            m_buffer.clear();
+        }
+        m_stream->flush();
+        return static_cast<bool>(*m_stream);
+    }
+    return true;
+}
+
+void JsonWriter::write(std::string_view text) {
+    if (m_string) {
+        m_string->append(text.data(), text.size());
+        return;
+    }
+    m_buffer.append(text.data(), text.size());
+    if (m_buffer.size() >= FlushThreshold) {
+        m_stream->write(m_buffer.data(), static_cast<std::streamsize>(m_buffer.size()));
+        m_buffer.clear();
+    }
+}
+
+void JsonWriter::write(char c) {
+    write(std::string_view(&c, 1));
+}
+
+void JsonWriter::newline(size_t depth) {
+    write('\n');
+    write(std::string(depth * m_indent, ' '));
+}
+
+void JsonWriter::beforeValue() {
+    if (m_afterKey) {
+        m_afterKey = false;
+        return;
+    }
+    if (m_levels.empty()) return;
+
+    Level& level = m_levels.back();
+    if (level.count++ > 0) write(',');
+    if (m_style == Style::Pretty) newline(m_levels.size());
+}
+
+JsonWriter& JsonWriter::begin(bool object, char bracket) {
+    beforeValue();
+    write(bracket);
+    m_levels.push_back({object, 0});
+    return *this;
+}
+
+JsonWriter& JsonWriter::end(char bracket) {
+    bool hadMembers = !m_levels.empty() && m_levels.back().count > 0;
+    if (!m_levels.empty()) m_levels.pop_back();
+    if (m_style == Style::Pretty && hadMembers) newline(m_levels.size());
+    write(bracket);
+    return *this;
+}
+
+JsonWriter& JsonWriter::beginObject() { return begin(true, '{'); }
+JsonWriter& JsonWriter::endObject() { return end('}'); }
+JsonWriter& JsonWriter::beginArray() { return begin(false, '['); }
+JsonWriter& JsonWriter::endArray() { return end(']'); }
+
+JsonWriter& JsonWriter::key(std::string_view name) {
+    beforeValue();
+    writeString(name);
+    write(m_style == Style::Pretty ? std::string_view(": ") : std::string_view(":"));
+    m_afterKey = true;
+    return *this;
+}
+
+JsonWriter& JsonWriter::value(std::string_view text) {
+    beforeValue();
+    writeString(text);
+    return *this;
+}
+
+JsonWriter& JsonWriter::value(bool flag) {
+    beforeValue();
+    write(flag ? std::string_view("true") : std::string_view("false"));
+    return *this;
+}
+
+JsonWriter& JsonWriter::null() {
+    beforeValue();
+    write(std::string_view("null"));
+    return *this;
+}
+
+JsonWriter& JsonWriter::integer(long long number) {
+    beforeValue();
+    char digits[24];
+    auto result = std::to_chars(digits, digits + sizeof(digits), number);
+    write(std::string_view(digits, result.ptr - digits));
+    return *this;
+}
+
+JsonWriter& JsonWriter::unsignedInteger(unsigned long long number) {
+    beforeValue();
+    char digits[24];
+    auto result = std::to_chars(digits, digits + sizeof(digits), number);
+    write(std::string_view(digits, result.ptr - digits));
+    return *this;
+}
+
+JsonWriter& JsonWriter::value(double number) {
+    if (!std::isfinite(number)) {
+        return null();  // as nlohmann::json does
+    }
+    beforeValue();
+
+    // Shortest of 15 or 17 digits that reads back exactly
+    char digits[32];
+    int length = std::snprintf(digits, sizeof(digits), "%.15g", number);
+    if (std::strtod(digits, nullptr) != number) {
+        length = std::snprintf(digits, sizeof(digits), "%.17g", number);
+    }
+    std::string_view text(digits, length);
+    write(text);
+    if (text.find_first_of(".eEn") == std::string_view::npos) {
+        write(std::string_view(".0"));
+    }
+    return *this;
+}
+
+JsonWriter& JsonWriter::value(const nlohmann::json& tree) {
+    switch (tree.type()) {
+    case nlohmann::json::value_t::object:
+        beginObject();
+        for (auto it = tree.begin(); it != tree.end(); ++it) {
+            key(it.key());
+            value(it.value());
+        }
+        return endObject();
+    case nlohmann::json::value_t::array:
+        beginArray();
+        for (const auto& element : tree) {
+            value(element);
+        }
+        return endArray();
+    case nlohmann::json::value_t::string:
+        return value(std::string_view(tree.get_ref<const std::string&>()));
+    case nlohmann::json::value_t::boolean:
+        return value(tree.get<bool>());
+    case nlohmann::json::value_t::number_integer:
+        return integer(tree.get<long long>());
+    case nlohmann::json::value_t::number_unsigned:
+        return unsignedInteger(tree.get<unsigned long long>());
+    case nlohmann::json::value_t::number_float:
+        return value(tree.get<double>());
+    default:
+        return null();
+    }
+}
+
+void JsonWriter::writeString(std::string_view text) {
+    static const char hex[] = "0123456789abcdef";
+
+    write('"');
+    size_t runStart = 0;
+    size_t i = 0;
+    auto flushRun = [&]() {
+        if (i > runStart) write(text.substr(runStart, i - runStart));
+    };
+
+    while (i < text.size()) {
+        unsigned char c = static_cast<unsigned char>(text[i]);
+        if (c >= 0x20 && c != '"' && c != '\\' && c < 0x80) {
+            ++i;
+            continue;
+        }
+        if (c >= 0x80) {
+            size_t length = utf8SequenceLength(text, i);
+            if (length > 0) {
+                i += length;
+                continue;
+            }
+            // Invalid UTF-8 becomes U+FFFD instead of producing an invalid document
+            flushRun();
+            write(std::string_view("\xEF\xBF\xBD"));
+            runStart = ++i;
+            continue;
+        }
+
+        flushRun();
+        switch (c) {
+        case '"': write(std::string_view("\\\"")); break;
+        case '\\': write(std::string_view("\\\\")); break;
+        case '\b': write(std::string_view("\\b")); break;
+        case '\f': write(std::string_view("\\f")); break;
+        case '\n': write(std::string_view("\\n")); break;
+        case '\r': write(std::string_view("\\r")); break;
+        case '\t': write(std::string_view("\\t")); break;
+        default: {
+            char escaped[] = {'\\', 'u', '0', '0', hex[c >> 4], hex[c & 0xF]};
+            write(std::string_view(escaped, sizeof(escaped)));
+        }
+        }
+        runStart = ++i;
+    }
+    flushRun();
+    write('"');
+}
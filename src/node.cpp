@@ -1,20 +1,15 @@
 #include "node.h"
-#include <algorithm>
 #include <sstream>
 #include <iomanip>
 
 size_t CFGNode::s_nodeCounter = 0;
 
 CFGNode::CFGNode(const std::string& content, NodeType type)
-    : m_content(content), m_type(type)
+    : m_content(content), m_type(type), m_serial(s_nodeCounter++)
 {
-    // Generate a unique identifier
-    std::ostringstream oss;
-    oss << "node_" << std::setw(4) << std::setfill('0') << s_nodeCounter++;
-    m_uniqueId = oss.str();
 }
 
-std::string CFGNode::getContent() const {
+const std::string& CFGNode::getContent() const {
     return m_content;
 }
 
@@ -33,28 +28,54 @@ std::string CFGNode::getTypeString() const {
     }
 }
 
-void CFGNode::addSuccessor(std::shared_ptr<CFGNode> node) {
-    // Prevent duplicate successors
-    if (std::find(m_successors.begin(), m_successors.end(), node) == m_successors.end()) {
-        m_successors.push_back(node);
-    }
+std::string CFGNode::getUniqueId() const {
+    // Formatted on demand rather than stored in every node
+    std::ostringstream oss;
+    oss << "node_" << std::setw(4) << std::setfill('0') << m_serial;
+    return oss.str();
+}
+
+CFGNodeGraph::Handle CFGNodeGraph::addNode(const std::string& content, CFGNode::NodeType type) {
+    Handle handle = static_cast<Handle>(m_nodes.size());
+    m_nodes.emplace_back(content, type);
+    m_successors.emplace_back();
+    m_predecessors.emplace_back();
+    return handle;
 }
 
-void CFGNode::addPredecessor(std::shared_ptr<CFGNode> node) {
-    // Prevent duplicate predecessors
-    if (std::find(m_predecessors.begin(), m_predecessors.end(), node) == m_predecessors.end()) {
-        m_predecessors.push_back(node);
+bool CFGNodeGraph::addEdge(Handle from, Handle to) {
+    if (!contains(from) || !contains(to)) {
+        return false;
     }
+    // Prevent duplicate edges without scanning the adjacency lists
+    if (m_edges.insert(edgeKey(from, to)).second) {
+        m_successors[from].push_back(to);
+        m_predecessors[to].push_back(from);
+    }
+    return true;
 }
 
-std::vector<std::shared_ptr<CFGNode>> CFGNode::getSuccessors() const {
-    return m_successors;
+CFGNodeGraph::HandleRange CFGNodeGraph::successors(Handle node) const {
+    if (!contains(node)) return HandleRange(nullptr, nullptr);
+    const std::vector<Handle>& list = m_successors[node];
+    return HandleRange(list.data(), list.data() + list.size());
 }
 
-std::vector<std::shared_ptr<CFGNode>> CFGNode::getPredecessors() const {
-    return m_predecessors;
+CFGNodeGraph::HandleRange CFGNodeGraph::predecessors(Handle node) const {
+    if (!contains(node)) return HandleRange(nullptr, nullptr);
+    const std::vector<Handle>& list = m_predecessors[node];
+    return HandleRange(list.data(), list.data() + list.size());
 }
 
-std::string CFGNode::getUniqueId() const {
-    return m_uniqueId;
-}
\ No newline at end of file
+void CFGNodeGraph::reserve(size_t nodes) {
+    m_nodes.reserve(nodes);
+    m_successors.reserve(nodes);
+    m_predecessors.reserve(nodes);
+}
+
+void CFGNodeGraph::clear() {
+    m_nodes.clear();
+    m_successors.clear();
+    m_predecessors.clear();
+    m_edges.clear();
+}
@@ -0,0 +1,213 @@
+#include "output_writer.h"
+#include "cfg_bundle.h"
+#include "graph_generator.h"
+#include "visualizer.h"
+#include <llvm/Support/FileSystem.h>
+#include <algorithm>
+#include <fstream>
+#include <utility>
+#include <vector>
+#include <QDebug>
+
+namespace {
+
+    // Jobs taken from the queue at a time; their temporary files are all written before
+    // any of them is renamed into place
+    constexpr size_t MaxBatch = 64;
+
+} // namespace
+
+OutputWriter& OutputWriter::instance() {
+    static OutputWriter writer;
+    return writer;
+}
+
+OutputWriter::~OutputWriter() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = true;
+    }
+    m_hasWork.notify_all();
+    if (m_thread.joinable()) {
+        m_thread.join();
+    }
+}
+
+void OutputWriter::submitDot(const std::string& path,
+                             std::shared_ptr<const GraphGenerator::CFGGraph> graph,
+                             std::shared_ptr<OutputTicket> ticket, DoneCallback done) {
+    if (!graph) return;
+    Job job{path, std::move(graph), std::string()};
+    job.ticket = std::move(ticket);
+    job.done = std::move(done);
+    enqueue(std::move(job));
+}
+
+void OutputWriter::submit(const std::string& path, std::string content,
+                          std::shared_ptr<OutputTicket> ticket) {
+    Job job{path, nullptr, std::move(content)};
+    job.ticket = std::move(ticket);
+    enqueue(std::move(job));
+}
+
+void OutputWriter::submitRemoval(const std::string& path, std::shared_ptr<OutputTicket> ticket) {
+    Job job{path, nullptr, std::string()};
+    job.remove = true;
+    job.ticket = std::move(ticket);
+    enqueue(std::move(job));
+}
+
+void OutputWriter::submitFunction(std::shared_ptr<GraphGenerator::BundleWriter> bundle,
+                                  const std::string& name, const std::string& usr,
+                                  std::shared_ptr<const GraphGenerator::CFGGraph> graph,
+                                  std::shared_ptr<OutputTicket> ticket) {
+    if (!bundle || !graph) return;
+    Job job{bundle->filename(), std::move(graph), std::string()};
+    job.bundle = std::move(bundle);
+    job.name = name;
+    job.usr = usr;
+    job.ticket = std::move(ticket);
+    enqueue(std::move(job));
+}
+
+void OutputWriter::setQueueCapacity(size_t jobs) {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_capacity = std::max<size_t>(1, jobs);
+    }
+    m_hasRoom.notify_all();
+}
+
+void OutputWriter::enqueue(Job job) {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    if (!m_thread.joinable()) {
+        m_thread = std::thread(&OutputWriter::run, this);
+    }
+    // Back pressure: producers wait instead of piling up rendered graphs in memory
+    m_hasRoom.wait(lock, [this] { return m_queue.size() < m_capacity; });
+    if (job.ticket) {
+        ++job.ticket->m_pending;
+    }
+    m_queue.push_back(std::move(job));
+    lock.unlock();
+    m_hasWork.notify_one();
+}
+
+size_t OutputWriter::flush(const std::shared_ptr<OutputTicket>& ticket) {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    if (ticket) {
+        m_drained.wait(lock, [&ticket] { return ticket->m_pending == 0; });
+        return std::exchange(ticket->m_failures, 0);
+    }
+    m_drained.wait(lock, [this] { return m_queue.empty() && m_writing == 0; });
+    return std::exchange(m_failures, 0);
+}
+
+void OutputWriter::run() {
+    std::vector<Job> batch;
+    std::vector<std::pair<std::string, Job*>> renames;  // temporary -> job, "" -> delete
+
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_hasWork.wait(lock, [this] { return m_stopping || !m_queue.empty(); });
+            if (m_queue.empty()) return;  // stopping, and nothing left to write
+
+            size_t count = std::min(m_queue.size(), MaxBatch);
+            batch.clear();
+            for (size_t i = 0; i < count; ++i) {
+                batch.push_back(std::move(m_queue.front()));
+                m_queue.pop_front();
+            }
+            m_writing = count;
+        }
+        m_hasRoom.notify_all();
+
+        renames.clear();
+        size_t sequence = 0;
+        for (Job& job : batch) {
+            if (job.remove) {
+                // In order with the renames, so it undoes an earlier write of the same path
+                renames.emplace_back(std::string(), &job);
+                continue;
+            }
+            try {
+                if (job.graph) {
+                    job.content = Visualizer::generateDotRepresentation(job.graph.get());
+                    job.graph.reset();
+                }
+            } catch (const std::exception& e) {
+                qWarning() << "Could not render" << job.path.c_str() << ":" << e.what();
+                job.failed = true;
+                continue;
+            }
+
+            if (job.bundle) {
+                if (!job.bundle->add(job.name, job.usr, GraphGenerator::Bundle::EntryKind::Dot,
+                                     job.content, job.bundle->compressEntries())) {
+                    job.failed = true;
+                }
+                job.bundle.reset();
+                std::string().swap(job.content);
+                continue;
+            }
+
+            // Numbered, so two jobs for the same path in a batch (overloads) do not share one
+            std::string tempPath = job.path + "." + std::to_string(sequence++) + ".tmp";
+            if (writeFile(tempPath, job.content)) {
+                renames.emplace_back(std::move(tempPath), &job);
+            } else {
+                job.failed = true;
+            }
+            std::string().swap(job.content);
+        }
+        for (const auto& [tempPath, job] : renames) {
+            if (tempPath.empty()) {
+                llvm::sys::fs::remove(job->path);
+                continue;
+            }
+            if (llvm::sys::fs::rename(tempPath, job->path)) {
+                llvm::sys::fs::remove(tempPath);
+                qWarning() << "Could not replace output file" << job->path.c_str();
+                job->failed = true;
+            }
+        }
+        // Before the jobs count as finished, so a flush() also waits for these
+        for (Job& job : batch) {
+            if (job.done) {
+                job.done(!job.failed);
+                job.done = nullptr;
+            }
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            for (Job& job : batch) {
+                if (job.ticket) {
+                    --job.ticket->m_pending;
+                    job.ticket->m_failures += job.failed;
+                } else {
+                    m_failures += job.failed;
+                }
+            }
+            m_writing = 0;
+        }
+        m_drained.notify_all();
+    }
+}
+
+bool OutputWriter::writeFile(const std::string& path, const std::string& content) {
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    if (!out.is_open()) {
+        qWarning() << "Could not write output file" << path.c_str();
+        return false;
+    }
+    out.write(content.data(), static_cast<std::streamsize>(content.size()));
+    out.close();
+    if (!out) {
+        qWarning() << "Could not write output file" << path.c_str();
+        llvm::sys::fs::remove(path);
+        return false;
+    }
+    return true;
+}
@@ -1,4 +1,10 @@
 #include "parser.h"
+#include "analysis_scope.h"
+#include "ast_cache.h"
+#include "compile_commands.h"
+#include "dot_writer.h"
+#include "graph_generator.h"
+#include "preamble_cache.h"
 #include <clang/AST/RecursiveASTVisitor.h>
 #include <clang/Analysis/CFG.h>
 #include <clang/AST/Stmt.h>
@@ -10,7 +16,9 @@
 #include <clang/Frontend/CompilerInstance.h>
 #include <clang/Frontend/CompilerInvocation.h>
 #include <clang/Frontend/FrontendActions.h>
-#include <regex>
+#include <clang/Frontend/Utils.h>
+#include <clang/Serialization/PCHContainerOperations.h>
+#include <llvm/Support/MemoryBuffer.h>
 #include <filesystem>
 #include <sstream>
 #include <fstream>
@@ -20,15 +28,18 @@
 using namespace clang;
 namespace fs = std::filesystem;
 
-// Cache for statement strings to improve performance
-static std::unordered_map<std::string, std::string> stmtCache;
-
 class Parser::FunctionVisitor : public RecursiveASTVisitor<FunctionVisitor> {
 public:
-    explicit FunctionVisitor(ASTContext* context) : context(context) {}
+    explicit FunctionVisitor(ASTContext* context)
+        : context(context), scope(AnalysisScope::current(), context->getSourceManager()) {}
+
+    bool TraverseDecl(Decl* decl) {
+        if (decl && !isa<TranslationUnitDecl>(decl) && !scope.contains(decl)) return true;
+        return RecursiveASTVisitor<FunctionVisitor>::TraverseDecl(decl);
+    }
     
     bool VisitFunctionDecl(FunctionDecl* decl) {
-        if (!decl->hasBody()) return true;
+        if (!decl->hasBody() || !scope.contains(decl)) return true;
         
         auto loc = context->getSourceManager().getPresumedLoc(decl->getLocation());
         if (!loc.isValid()) return true;
@@ -56,6 +67,7 @@ public:
 
 private:
     ASTContext* context;
+    AnalysisScope::Filter scope;
     std::vector<FunctionInfo> functions;
     std::map<std::string, FunctionDecl*> functionDecls;
 };
@@ -93,84 +105,15 @@ std::vector<Parser::FunctionCFG> Parser::extractAllCFGs(const std::string& fileP
             FunctionVisitor visitor(context);
             visitor.TraverseDecl(context->getTranslationUnitDecl());
             
+            // Built straight into the shared CFG model; all functions share one statement pool
+            std::shared_ptr<GraphGenerator::StatementPool> statements;
             for (const auto& funcInfo : visitor.getFunctions()) {
                 if (FunctionDecl* decl = visitor.getFunctionDecl(funcInfo.name)) {
-                    FunctionCFG cfg;
-                    cfg.functionName = funcInfo.name;
-                    
-                    std::unique_ptr<CFG> cfgPtr = CFG::buildCFG(
-                        decl, 
-                        decl->getBody(), 
-                        context, 
-                        CFG::BuildOptions()
-                    );
-                    
-                    if (!cfgPtr) continue;
+                    std::shared_ptr<const GraphGenerator::CFGGraph> graph = GraphGenerator::generateCFG(
+                        decl, GraphGenerator::StatementPool::acquire(statements));
+                    if (!graph) continue;
                     
-                    // Process nodes
-                    for (const CFGBlock* block : *cfgPtr) {
-                        CFGNode node;
-                        node.id = block->getBlockID();
-                        
-                        std::string label;
-                        if (block->empty()) {
-                            label = (node.id == 0) ? "ENTRY" : "EXIT";
-                        } else {
-                            for (const auto& element : *block) {
-                                if (element.getKind() == CFGElement::Statement) {
-                                    const Stmt* stmt = element.castAs<CFGStmt>().getStmt();
-                                    std::string stmtStr;
-                                    llvm::raw_string_ostream os(stmtStr);
-                                    stmt->printPretty(os, nullptr, PrintingPolicy(context->getLangOpts()));
-                                    os.flush();
-                                    
-                                    if (stmtCache.count(stmtStr)) {
-                                        label += stmtCache[stmtStr];
-                                    } else {
-                                        stmtCache[stmtStr] = stmtStr + "\n";
-                                        label += stmtCache[stmtStr];
-                                    }
-                                    
-                                    if (node.code.empty()) node.code = stmtStr;
-                                }
-                            }
-                        }
-                        
-                        node.label = label.empty() ? "Empty Block" : label;
-                        SourceLocation loc = block->empty() ? SourceLocation() :
-                            (block->front().getKind() == CFGElement::Statement) ?
-                                block->front().castAs<CFGStmt>().getStmt()->getBeginLoc() :
-                                SourceLocation();
-                        auto presumedLoc = context->getSourceManager().getPresumedLoc(loc);
-                        node.line = presumedLoc.isValid() ? presumedLoc.getLine() : 0;
-                        
-                        cfg.nodes.push_back(node);
-                    }
-                    
-                    // Process edges
-                    for (const CFGBlock* block : *cfgPtr) {
-                        unsigned sourceId = block->getBlockID();
-                        unsigned edgeIdx = 0;
-                        
-                        for (auto it = block->succ_begin(); it != block->succ_end(); ++it) {
-                            if (const CFGBlock* succ = *it) {
-                                CFGEdge edge;
-                                edge.sourceId = sourceId;
-                                edge.targetId = succ->getBlockID();
-                                
-                                if (block->succ_size() > 1) {
-                                    edge.label = (edgeIdx == 0) ? "True" : "False";
-                                } else {
-                                    edge.label = "Unconditional";
-                                }
-                                
-                                cfg.edges.push_back(edge);
-                                edgeIdx++;
-                            }
-                        }
-                    }
-                    
-                    cfgs.push_back(cfg);
+                    cfgs.push_back({funcInfo.name, std::move(graph)});
                 }
             }
         } catch (const std::exception& e) {
@@ -182,108 +125,141 @@ std::vector<Parser::FunctionCFG> Parser::extractAllCFGs(const std::string& fileP
 }
 
 std::string Parser::generateDOT(const FunctionCFG& cfg) {
-    std::ostringstream dot;
-    dot << "digraph \"" << cfg.functionName << "\" {\n";
-    dot << "  node [shape=rectangle, fontname=\"Courier\", fontsize=10];\n";
-    dot << "  edge [fontsize=8];\n\n";
+    std::string dot;
+    DotWriter writer(dot);
+    if (cfg.graph) {
+        writer.reserve(DotWriter::estimateSize(cfg.graph->getNodeCount(), cfg.graph->getEdgeCount()));
+    }
+    writer.beginGraph(cfg.functionName)
+        .raw("  node [shape=rectangle, fontname=\"Courier\", fontsize=10];\n")
+        .raw("  edge [fontsize=8];\n\n");
+    if (!cfg.graph) {
+        writer.endGraph();
+        return dot;
+    }
+    const GraphGenerator::CFGGraph& graph = *cfg.graph;
     
     // Add nodes
-    for (const auto& node : cfg.nodes) {
-        dot << "  " << node.id << " [";
+    for (const auto& [id, node] : graph.getNodes()) {
+        writer.raw("  ").number(id).raw(" [");
         
-        if (node.id == 0) {
-            dot << "label=\"ENTRY\", shape=diamond, style=filled, fillcolor=palegreen";
-        } else if (node.id == 1 && cfg.nodes.size() > 1) {
-            dot << "label=\"EXIT\", shape=diamond, style=filled, fillcolor=palegreen";
+        if (id == 0) {
+            writer.raw("label=\"ENTRY\", shape=diamond, style=filled, fillcolor=palegreen");
+        } else if (id == 1 && graph.getNodeCount() > 1) {
+            writer.raw("label=\"EXIT\", shape=diamond, style=filled, fillcolor=palegreen");
+        } else if (node.statements.empty()) {
+            writer.raw("label=\"Empty Block\"");
         } else {
-            // Escape special characters
-            std::string label = node.label;
-            std::replace(label.begin(), label.end(), '"', '\'');
-            label = std::regex_replace(label, std::regex("\n"), "\\n");
-            
-            dot << "label=\"" << label << "\"";
+            // One statement per line
+            writer.raw("label=\"");
+            for (std::string_view stmt : node.statements) {
+                writer.escaped(stmt).raw("\\n");
+            }
             
             // Highlight complex nodes
-            if (node.label.find('\n') != std::string::npos) {
-                dot << ", style=filled, fillcolor=lemonchiffon";
-            }
+            writer.raw("\", style=filled, fillcolor=lemonchiffon");
         }
         
-        dot << "];\n";
+        writer.raw("];\n");
     }
     
     // Add edges
-    for (const auto& edge : cfg.edges) {
-        dot << "  " << edge.sourceId << " -> " << edge.targetId;
-        
-        if (!edge.label.empty()) {
-            dot << " [label=\"" << edge.label << "\"";
+    for (const auto& [id, node] : graph.getNodes()) {
+        for (int successor : node.successors) {
+            uint8_t flags = graph.getEdgeFlags(id, successor);
+            writer.edge(id, successor);
             
-            if (edge.label == "True" || edge.label == "False") {
-                dot << ", color=blue";
+            if (flags & GraphGenerator::CFGGraph::TrueBranch) {
+                writer.raw(" [label=\"True\", color=blue]");
+            } else if (flags & GraphGenerator::CFGGraph::FalseBranch) {
+                writer.raw(" [label=\"False\", color=blue]");
+            } else {
+                writer.raw(" [label=\"Unconditional\"]");
             }
             
+            writer.raw(";\n");
         }
-        
-        dot << ";\n";
     }
 
-    dot << "}\n";
-    return dot.str();
+    writer.endGraph();
+    return dot;
 }
 
-std::unique_ptr<clang::ASTUnit> Parser::parseFileWithAST(const std::string& filename) {
+std::unique_ptr<clang::ASTUnit> Parser::parseFileWithAST(const std::string& filename,
+    const clang::tooling::CompilationDatabase* compilations) {
     if (!fs::exists(filename)) {
         qWarning() << "File not found:" << filename.c_str();
         return nullptr;
     }
 
-    // Find Clang resource directory
-    std::string resourceDir;
-    if (llvm::sys::fs::exists("/usr/lib/llvm-14/lib/clang/14.0.0/include")) {
-        resourceDir = "/usr/lib/llvm-14/lib/clang/14.0.0/include";
-    } else {
-        // Fallback to searching common paths
-        for (const auto& entry : fs::directory_iterator("/usr/lib/llvm")) {
-            if (entry.path().string().find("clang") != std::string::npos) {
-                resourceDir = entry.path().string() + "/include";
-                break;
-            }
-        }
+    // Without a database entry fall back to the old fixed flags
+    std::unique_ptr<clang::tooling::CompilationDatabase> fallback;
+    if (!compilations || compilations->getCompileCommands(filename).empty()) {
+        std::vector<std::string> args = CompileCommands::defaultArguments();
+        args.insert(args.end(), {"-ferror-limit=2", "-fno-exceptions", "-O0", "-Wno-everything"});
+        fallback = std::make_unique<clang::tooling::FixedCompilationDatabase>(".", args);
+        compilations = fallback.get();
     }
 
-    std::vector<std::string> args = {
-        "-std=c++17",
-        "-I.",
-        "-ferror-limit=2",
-        "-fno-exceptions",
-        "-O0",
-        "-Wno-everything",
-        "-resource-dir=" + resourceDir
-    };
-
-    auto ast = clang::tooling::buildASTFromCodeWithArgs("", args, filename);
-    
+    // An unchanged TU is loaded from the on-disk AST cache instead of being re-parsed;
+    // a changed one reuses the precompiled preamble of its system includes
+    std::unique_ptr<clang::ASTUnit> ast = ASTCache::instance().loadOrBuild(
+        *compilations, filename,
+        {CompileCommands::resourceDirAdjuster(), PreambleCache::instance().adjuster(compilations)});
     if (!ast) {
         qCritical() << "AST generation failed for:" << filename.c_str();
-        if (ast && ast->getDiagnostics().getNumErrors()) {
-            qCritical() << "Diagnostics:";
-            // Replace the iterator-based approach with direct reporting
-            const auto& diags = ast->getDiagnostics();
-            qCritical() << "Found" << diags.getNumErrors() << "errors and" 
-                       << diags.getNumWarnings() << "warnings";
-            
-            // We can't iterate through diagnostics directly, so log this info
-            qCritical() << "See compiler output for details";
-        }
+        return nullptr;
+    }
+
+    const auto& diags = ast->getDiagnostics();
+    if (diags.hasErrorOccurred()) {
+        qCritical() << "Found" << diags.getNumErrors() << "errors and"
+                   << diags.getNumWarnings() << "warnings in" << filename.c_str();
     }
     return ast;
 }
 
-clang::ASTContext* Parser::ThreadLocalState::parse(const std::string& filePath) {
+namespace {
+
+// Hands the finished ASTContext to the state's ASTStoringConsumer
+class StoreContextAction : public ASTFrontendAction {
+public:
+    explicit StoreContextAction(Parser::ASTStoringConsumer& target) : target(target) {}
+
+    std::unique_ptr<ASTConsumer> CreateASTConsumer(CompilerInstance&, llvm::StringRef) override {
+        struct Forwarder : public ASTConsumer {
+            explicit Forwarder(Parser::ASTStoringConsumer& t) : t(t) {}
+            void HandleTranslationUnit(ASTContext& Context) override { t.HandleTranslationUnit(Context); }
+            Parser::ASTStoringConsumer& t;
+        };
+        return std::make_unique<Forwarder>(target);
+    }
+
+private:
+    Parser::ASTStoringConsumer& target;
+};
+
+} // namespace
+
+clang::ASTContext* Parser::ThreadLocalState::parse(const std::string& filePath,
+    const clang::tooling::CompilationDatabase* compilations) {
+    consumer = std::make_unique<ASTStoringConsumer>();
+    StoreContextAction action(*consumer);
+
+    // The context has to outlive the action, so let the compiler leak it like clang does
+    if (!execute(filePath, compilations, action, true)) {
+        return nullptr;
+    }
+    return consumer->Context;
+}
+
+bool Parser::ThreadLocalState::execute(const std::string& filePath,
+    const clang::tooling::CompilationDatabase* compilations,
+    clang::FrontendAction& action,
+    bool keepAST) {
     if (!fs::exists(filePath)) {
         qWarning() << "File not found:" << filePath.c_str();
-        return nullptr;
+        return false;
     }
 
     try {
@@ -292,56 +268,135 @@ clang::ASTContext* Parser::ThreadLocalState::parse(const std::string& filePath)
             setupCompiler();
         }
 
-        consumer = std::make_unique<ASTStoringConsumer>();
-        
-        std::vector<std::string> args = {
-            "-x", "c++", 
-            "-std=c++17",
-            "-I.", 
-            "-I/usr/include",
-            "-I/usr/local/include",
-            filePath
-        };
-        
+        // Driver-level command line from compile_commands.json (or the default flags)
+        std::string workingDirectory;
+        std::vector<std::string> args =
+            CompileCommands::commandLineForFile(compilations, filePath, &workingDirectory);
+        args = PreambleCache::instance().adjustCommandLine(args, filePath, workingDirectory);
+
         std::vector<const char*> cArgs;
         for (const auto& arg : args) {
             cArgs.push_back(arg.c_str());
         }
 
-        if (!CompilerInvocation::CreateFromArgs(
-            compiler->getInvocation(),
-            cArgs,
-            compiler->getDiagnostics())) {
+        std::shared_ptr<CompilerInvocation> invocation =
+            createInvocationFromCommandLine(cArgs, &compiler->getDiagnostics());
+        if (!invocation) {
             qWarning() << "Failed to create compiler invocation";
-            return nullptr;
+            return false;
         }
+        invocation->getFileSystemOpts().WorkingDir = workingDirectory;
+        invocation->getFrontendOpts().DisableFree = keepAST;
+        compiler->setInvocation(std::move(invocation));
 
-        compiler->setASTConsumer(std::move(consumer));
-        SyntaxOnlyAction action;
-        if (!compiler->ExecuteAction(action)) {
-            qWarning() << "Failed to execute parse action";
-            return nullptr;
+        // The FileManager (and its stat/content caches) survives across TUs; relative
+        // paths are resolved against its working directory, so only swap it when that changes.
+        if (compiler->getFileManager().getFileSystemOpts().WorkingDir != workingDirectory) {
+            compiler->createFileManager();
+            compiler->createSourceManager(compiler->getFileManager());
         }
+        compiler->getDiagnostics().Reset();
+        compiler->getDiagnosticClient().clear();
 
-        return consumer->Context;
+        if (!compiler->ExecuteAction(action)) {
+            qWarning() << "Failed to execute action on" << filePath.c_str();
+            return false;
+        }
+        return true;
     } catch (const std::exception& e) {
         qCritical() << "Parser exception:" << e.what();
-        return nullptr;
+        return false;
     }
 }
 
 void Parser::ThreadLocalState::setupCompiler() {
+    // Preprocessor and ASTContext are per TU and get created by each action;
+    // only the diagnostics and file/source managers are kept between runs.
     compiler->createDiagnostics();
     compiler->createFileManager();
     compiler->createSourceManager(compiler->getFileManager());
-    compiler->createPreprocessor(TU_Complete);
-    compiler->createASTContext();
+}
+
+struct Parser::LiveUnit {
+    std::string filename;
+    std::vector<std::string> commandLine;
+    std::shared_ptr<PCHContainerOperations> pchOperations = std::make_shared<PCHContainerOperations>();
+    std::unique_ptr<ASTUnit> unit;
+};
+
+clang::ASTUnit* Parser::parseUnsaved(const std::string& filename, const UnsavedFiles& unsavedFiles) {
+    if (!m_live) {
+        m_live = std::make_unique<LiveUnit>();
+    }
+
+    std::string workingDirectory;
+    std::vector<std::string> args =
+        CompileCommands::commandLineForFile(m_compilations.get(), filename, &workingDirectory);
+    if (!workingDirectory.empty() && !args.empty()) {
+        args.insert(args.begin() + 1, {"-working-directory", workingDirectory});
+    }
+
+    // ASTUnit takes ownership of the remapped buffers
+    auto remappedFiles = [&unsavedFiles]() {
+        std::vector<ASTUnit::RemappedFile> remapped;
+        for (const auto& [path, contents] : unsavedFiles) {
+            remapped.emplace_back(path, llvm::MemoryBuffer::getMemBufferCopy(contents, path).release());
+        }
+        return remapped;
+    };
+
+    try {
+        if (m_live->unit && m_live->filename == filename && m_live->commandLine == args) {
+            // Only the main file body is re-parsed while the #include block stays the same
+            if (!m_live->unit->Reparse(m_live->pchOperations, remappedFiles())) {
+                return m_live->unit.get();
+            }
+            qWarning() << "Reparse failed for" << filename.c_str() << "- parsing from scratch";
+        }
+        m_live->unit.reset();
+
+        std::vector<const char*> cArgs;
+        for (const auto& arg : args) {
+            cArgs.push_back(arg.c_str());
+        }
+
+        auto diagnostics = CompilerInstance::createDiagnostics(
+            new DiagnosticOptions(), new IgnoringDiagConsumer());
+        m_live->unit.reset(ASTUnit::LoadFromCommandLine(
+            cArgs.data(), cArgs.data() + cArgs.size(), m_live->pchOperations, diagnostics,
+            /*ResourceFilesPath=*/"", /*OnlyLocalDecls=*/false, CaptureDiagsKind::All,
+            remappedFiles(), /*RemappedFilesKeepOriginalName=*/true,
+            /*PrecompilePreambleAfterNParses=*/1, TU_Complete,
+            /*CacheCodeCompletionResults=*/false, /*IncludeBriefCommentsInCodeCompletion=*/false,
+            /*AllowPCHWithCompilerErrors=*/false, SkipFunctionBodiesScope::None,
+            /*SingleFileParse=*/false, /*UserFilesAreVolatile=*/true));
+    } catch (const std::exception& e) {
+        qCritical() << "Parser exception:" << e.what();
+        m_live->unit.reset();
+    }
+
+    if (!m_live->unit) {
+        qCritical() << "Failed to parse unsaved buffers for" << filename.c_str();
+        return nullptr;
+    }
+    m_live->filename = filename;
+    m_live->commandLine = std::move(args);
+    return m_live->unit.get();
+}
+
+void Parser::releaseUnsaved() {
+    m_live.reset();
 }
 
 Parser::Parser() {
     // Initialize any necessary members here
 }
 
+void Parser::setCompilationDatabase(
+    std::shared_ptr<const clang::tooling::CompilationDatabase> compilations) {
+    m_compilations = std::move(compilations);
+}
+
 // Destructor implementation
 Parser::~Parser() {
     // Clean up any resources if needed
@@ -350,7 +405,7 @@ Parser::~Parser() {
 // parseFile implementation
 clang::ASTContext* Parser::parseFile(const std::string& filePath) {
     thread_local ThreadLocalState state;
-    return state.parse(filePath);
+    return state.parse(filePath, m_compilations.get());
 }
 
 Parser::ThreadLocalState::~ThreadLocalState() {
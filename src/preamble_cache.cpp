@@ -0,0 +1,238 @@
+#include "preamble_cache.h"
+#include "file_hash.h"
+#include <clang/Basic/SourceManager.h>
+#include <clang/Frontend/CompilerInstance.h>
+#include <clang/Frontend/CompilerInvocation.h>
+#include <clang/Frontend/FrontendActions.h>
+#include <clang/Frontend/Utils.h>
+#include <llvm/Support/Chrono.h>
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/Path.h>
+#include <llvm/Support/xxhash.h>
+#include <fstream>
+#include <sstream>
+#include <QDebug>
+
+namespace {
+
+    std::string trim(const std::string& line) {
+        size_t begin = line.find_first_not_of(" \t\r");
+        if (begin == std::string::npos) return "";
+        size_t end = line.find_last_not_of(" \t\r");
+        return line.substr(begin, end - begin + 1);
+    }
+
+} // namespace
+
+PreambleCache& PreambleCache::instance() {
+    static PreambleCache cache;
+    return cache;
+}
+
+PreambleCache::PreambleCache() : m_enabled(true) {
+    llvm::SmallString<128> dir;
+    llvm::sys::path::system_temp_directory(true, dir);
+    llvm::sys::path::append(dir, "cfgparser-preambles");
+    m_directory = std::string(dir.str());
+}
+
+void PreambleCache::setEnabled(bool enabled) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_enabled = enabled;
+}
+
+bool PreambleCache::isEnabled() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_enabled;
+}
+
+void PreambleCache::setCacheDirectory(const std::string& directory) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_directory = directory;
+}
+
+std::string PreambleCache::cacheDirectory() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_directory;
+}
+
+std::string PreambleCache::leadingIncludes(const std::string& mainFile) {
+    std::ifstream in(mainFile);
+    if (!in.is_open()) return "";
+
+    // Only <...> includes go into the preamble: quoted ones resolve relative to the
+    // including file, which is the generated header once it lives in the cache.
+    std::string preamble;
+    std::string line;
+    bool inBlockComment = false;
+    while (std::getline(in, line)) {
+        std::string trimmed = trim(line);
+        if (inBlockComment) {
+            if (trimmed.find("*/") != std::string::npos) inBlockComment = false;
+            continue;
+        }
+        if (trimmed.empty() || trimmed.rfind("//", 0) == 0) continue;
+        if (trimmed.rfind("/*", 0) == 0) {
+            inBlockComment = trimmed.find("*/", 2) == std::string::npos;
+            continue;
+        }
+        if (trimmed == "#pragma once") continue;
+        if (trimmed.rfind("#include", 0) == 0 && trimmed.find('<') != std::string::npos) {
+            preamble += trimmed + "\n";
+            continue;
+        }
+        break;
+    }
+    return preamble;
+}
+
+std::vector<std::string> PreambleCache::adjustCommandLine(const std::vector<std::string>& commandLine,
+                                                          const std::string& mainFile,
+                                                          const std::string& workingDirectory) {
+    if (!isEnabled() || commandLine.empty()) return commandLine;
+
+    std::string preamble = leadingIncludes(mainFile);
+    if (preamble.empty()) return commandLine;
+
+    // Key: every flag except the file itself, the working directory and the include block
+    std::string keyText = workingDirectory + '\0' + preamble;
+    for (size_t i = 1; i < commandLine.size(); ++i) {
+        if (commandLine[i] != mainFile) keyText += '\0' + commandLine[i];
+    }
+    std::string key = file_hash::toHex(llvm::xxHash64(keyText));
+
+    llvm::SmallString<256> basePath(cacheDirectory());
+    llvm::sys::path::append(basePath, key);
+    std::string base = std::string(basePath.str());
+    std::string pchPath = base + ".pch";
+
+    {
+        auto buildLock = lockFor(key);
+        std::lock_guard<std::mutex> lock(*buildLock);
+        if (!isUpToDate(pchPath, base + ".deps") &&
+            !build(commandLine, mainFile, workingDirectory, preamble, base)) {
+            return commandLine;
+        }
+    }
+
+    std::vector<std::string> adjusted = commandLine;
+    adjusted.insert(adjusted.begin() + 1, {"-include-pch", pchPath});
+    return adjusted;
+}
+
+clang::tooling::ArgumentsAdjuster PreambleCache::adjuster(
+    const clang::tooling::CompilationDatabase* compilations) {
+    return [this, compilations](const clang::tooling::CommandLineArguments& args,
+                                llvm::StringRef filename) {
+        std::string workingDirectory = ".";
+        if (compilations) {
+            auto commands = compilations->getCompileCommands(filename);
+            if (!commands.empty()) workingDirectory = commands.front().Directory;
+        }
+        return adjustCommandLine(args, filename.str(), workingDirectory);
+    };
+}
+
+bool PreambleCache::isUpToDate(const std::string& pchPath, const std::string& depsPath) const {
+    if (!llvm::sys::fs::exists(pchPath)) return false;
+
+    std::ifstream deps(depsPath);
+    if (!deps.is_open()) return false;
+
+    // One "<mtime> <size> <path>" line per header that went into the PCH
+    std::string line;
+    while (std::getline(deps, line)) {
+        std::istringstream fields(line);
+        InputStamp stamp;
+        if (!(fields >> stamp.modificationTime >> stamp.size)) return false;
+        std::getline(fields >> std::ws, stamp.path);
+
+        llvm::sys::fs::file_status status;
+        if (llvm::sys::fs::status(stamp.path, status)) return false;
+        if (llvm::sys::toTimeT(status.getLastModificationTime()) != stamp.modificationTime ||
+            status.getSize() != stamp.size) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool PreambleCache::build(const std::vector<std::string>& commandLine,
+                          const std::string& mainFile,
+                          const std::string& workingDirectory,
+                          const std::string& preamble,
+                          const std::string& basePath) {
+    llvm::sys::fs::create_directories(llvm::sys::path::parent_path(basePath));
+
+    std::string headerPath = basePath + ".h";
+    {
+        std::ofstream header(headerPath, std::ios::trunc);
+        if (!header.is_open()) return false;
+        header << preamble;
+    }
+
+    // Same flags as the TU, but compiling the generated header instead of the main file
+    std::vector<std::string> args;
+    bool replacedMainFile = false;
+    for (const std::string& arg : commandLine) {
+        if (arg == mainFile) {
+            args.insert(args.end(), {"-x", "c++-header", headerPath});
+            replacedMainFile = true;
+        } else {
+            args.push_back(arg);
+        }
+    }
+    if (!replacedMainFile) return false;
+    std::vector<const char*> cArgs;
+    for (const auto& arg : args) {
+        cArgs.push_back(arg.c_str());
+    }
+
+    auto diagnostics = clang::CompilerInstance::createDiagnostics(
+        new clang::DiagnosticOptions(), new clang::IgnoringDiagConsumer());
+    std::shared_ptr<clang::CompilerInvocation> invocation =
+        clang::createInvocationFromCommandLine(cArgs, diagnostics);
+    if (!invocation) return false;
+
+    // Written under a temporary name so other processes never pick up a partial PCH
+    std::string tempPath = basePath + ".pch" + file_hash::tempSuffix();
+    invocation->getFileSystemOpts().WorkingDir = workingDirectory;
+    invocation->getFrontendOpts().OutputFile = tempPath;
+    invocation->getFrontendOpts().DisableFree = false;
+
+    clang::CompilerInstance compiler;
+    compiler.setInvocation(std::move(invocation));
+    compiler.setDiagnostics(diagnostics.get());
+
+    clang::GeneratePCHAction action;
+    if (!compiler.ExecuteAction(action) || diagnostics->hasErrorOccurred()) {
+        llvm::sys::fs::remove(tempPath);
+        qWarning() << "Could not build preamble for" << mainFile.c_str();
+        return false;
+    }
+
+    std::ofstream deps(basePath + ".deps", std::ios::trunc);
+    const clang::SourceManager& SM = compiler.getSourceManager();
+    for (auto it = SM.fileinfo_begin(); it != SM.fileinfo_end(); ++it) {
+        const clang::FileEntry* entry = it->first;
+        std::string path = entry->tryGetRealPathName().str();
+        if (path.empty()) path = entry->getName().str();
+        deps << entry->getModificationTime() << ' ' << entry->getSize() << ' ' << path << '\n';
+    }
+    deps.close();
+
+    if (llvm::sys::fs::rename(tempPath, basePath + ".pch")) {
+        llvm::sys::fs::remove(tempPath);
+        return false;
+    }
+    return true;
+}
+
+std::shared_ptr<std::mutex> PreambleCache::lockFor(const std::string& key) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto& buildLock = m_buildLocks[key];
+    if (!buildLock) {
+        buildLock = std::make_shared<std::mutex>();
+    }
+    return buildLock;
+}
@@ -0,0 +1,81 @@
+#include "statement_pool.h"
+#include <algorithm>
+#include <cstring>
+#include <mutex>
+#include <stdexcept>
+
+namespace GraphGenerator {
+
+StatementPool::Handle StatementPool::intern(std::string_view text) {
+    {
+        std::shared_lock<std::shared_mutex> lock(m_mutex);
+        auto it = m_index.find(text);
+        if (it != m_index.end()) {
+            return it->second;
+        }
+    }
+
+    std::unique_lock<std::shared_mutex> lock(m_mutex);
+    auto it = m_index.find(text);
+    if (it != m_index.end()) {
+        return it->second;
+    }
+
+    if (m_strings.size() >= UINT32_MAX) {
+        throw std::length_error("Statement pool is full");
+    }
+    std::string_view stored = store(text);
+    Handle handle = static_cast<Handle>(m_strings.size());
+    m_strings.push_back(stored);
+    m_index.emplace(stored, handle);
+    return handle;
+}
+
+std::string_view StatementPool::store(std::string_view text) {
+    if (text.empty()) return std::string_view();
+
+    m_bytes += text.size();
+    if (text.size() > MaxChunkSize / 4) {
+        // Large statements get their own block instead of wasting the current chunk
+        m_largeStrings.push_back(std::make_unique<char[]>(text.size()));
+        std::memcpy(m_largeStrings.back().get(), text.data(), text.size());
+        return std::string_view(m_largeStrings.back().get(), text.size());
+    }
+
+    if (m_chunks.empty() || m_chunkUsed + text.size() > m_chunkCapacity) {
+        // Chunks start small, so a pool behind a single small graph stays small
+        m_chunkCapacity = std::max(m_nextChunkSize, text.size());
+        m_chunks.push_back(std::make_unique<char[]>(m_chunkCapacity));
+        m_chunkUsed = 0;
+        m_nextChunkSize = std::min(m_nextChunkSize * 2, MaxChunkSize);
+    }
+    char* target = m_chunks.back().get() + m_chunkUsed;
+    std::memcpy(target, text.data(), text.size());
+    m_chunkUsed += text.size();
+    return std::string_view(target, text.size());
+}
+
+std::string_view StatementPool::get(Handle handle) const {
+    std::shared_lock<std::shared_mutex> lock(m_mutex);
+    return handle < m_strings.size() ? m_strings[handle] : std::string_view();
+}
+
+size_t StatementPool::size() const {
+    std::shared_lock<std::shared_mutex> lock(m_mutex);
+    return m_strings.size();
+}
+
+size_t StatementPool::byteSize() const {
+    std::shared_lock<std::shared_mutex> lock(m_mutex);
+    return m_bytes;
+}
+
+std::shared_ptr<StatementPool> StatementPool::acquire(std::shared_ptr<StatementPool>& pool,
+                                                      size_t maxBytes) {
+    if (!pool || pool->byteSize() >= maxBytes) {
+        pool = std::make_shared<StatementPool>();
+    }
+    return pool;
+}
+
+} // namespace GraphGenerator
@@ -1,12 +1,82 @@
 #include "visualizer.h"
+#include "dot_writer.h"
 #include <fstream>
-#include <sstream>
-#include <algorithm>
 #include <stdexcept>
+#include <unordered_set>
 #include <QDebug>
 
 namespace Visualizer {
 
+namespace {
+
+    void writeDot(
+        DotWriter& writer,
+        const GraphGenerator::CFGGraph& graph,
+        bool showLineNumbers,
+        bool simplifyGraph,
+        const std::vector<int>& highlightPaths)
+    {
+        const std::unordered_set<int> highlighted(highlightPaths.begin(), highlightPaths.end());
+
+        writer.beginGraph("CFG")
+            .raw("  node [shape=box, fontname=\"Courier\", fontsize=10];\n")
+            .raw("  edge [fontsize=8];\n");
+        
+        // Add nodes
+        for (const auto& [id, node] : graph.getNodes()) {
+            writer.raw("  ").number(id).raw(" [label=\"");
+            
+            if (showLineNumbers && node.line > 0) {
+                writer.raw("Line ").number(node.line).raw(": ");
+            }
+            if (node.label.empty()) {
+                writer.raw("Block ").number(id);
+            } else {
+                writer.escaped(node.label);
+            }
+            writer.raw('"');
+            
+            // Apply styles based on node properties
+            if (graph.isNodeTryBlock(id)) {
+                writer.raw(", style=filled, fillcolor=lightblue");
+            }
+            if (graph.isNodeThrowingException(id)) {
+                writer.raw(", style=filled, fillcolor=lightcoral");
+            }
+            if (highlighted.count(id)) {
+                writer.raw(", style=filled, fillcolor=yellow, penwidth=2");
+            }
+            if (simplifyGraph && node.successors.size() == 1) {
+                writer.raw(", shape=ellipse");
+            }
+            if (node.successors.size() > 1) {
+                writer.raw(", style=dashed, color=gray");
+            }
+            
+            writer.raw("];\n");
+        }
+        
+        // Add edges
+        for (const auto& [id, node] : graph.getNodes()) {
+            for (int succ : node.successors) {
+                writer.edge(id, succ);
+                
+                if (graph.isExceptionEdge(id, succ)) {
+                    writer.raw(" [color=red, style=dashed, label=\"exception\"]");
+                } 
+                else if (simplifyGraph && succ <= id) {  // Simple heuristic for back edges
+                    writer.raw(" [color=blue, style=bold]");
+                }
+                
+                writer.raw(";\n");
+            }
+        }
+        
+        writer.endGraph();
+    }
+
+} // namespace
+
 std::string generateDotRepresentation(
     const GraphGenerator::CFGGraph* graph,
     bool showLineNumbers,
@@ -17,67 +87,11 @@ std::string generateDotRepresentation(
         throw std::invalid_argument("Graph pointer cannot be null");
     }
 
-    std::stringstream dot;
-    dot << "digraph CFG {\n";
-    dot << "  node [shape=box, fontname=\"Courier\", fontsize=10];\n";
-    dot << "  edge [fontsize=8];\n";
-    
-    // Add nodes
-    for (const auto& [id, node] : graph->getNodes()) {
-        dot << "  " << id << " [label=\"";
-        
-        if (showLineNumbers) {
-            // Comment out the line number code since the method doesn't existn-existent method
-            // We can add this functionality back when we know the correct wayr > 0) {  // Assuming node has a lineNumber member
-            // to retrieve line numbers from the graph<< ": ";
-            // 
-            // int lineNum = graph->getNodeLineNumber(id);
-            // if (lineNum > 0) {
-            //     dot << "Line " << lineNum << ": ";
-            // }
-        }
-        dot << graph->getNodeLabel(id) << "\"";
-        
-        // Apply styles based on node properties
-        if (graph->isNodeTryBlock(id)) {
-            dot << ", style=filled, fillcolor=lightblue";
-        }
-        if (graph->isNodeThrowingException(id)) {
-            dot << ", style=filled, fillcolor=lightcoral";
-        }
-        if (std::find(highlightPaths.begin(), highlightPaths.end(), id) != highlightPaths.end()) {
-            dot << ", style=filled, fillcolor=yellow, penwidth=2";
-        }
-        if (simplifyGraph && node.successors.size() == 1) {
-            dot << ", shape=ellipse";
-        }
-        if (node.successors.size() > 1) {
-            dot << ", style=dashed, color=gray";
-        }
-        
-        dot << "];\n";
-    }
-    
-    // Add edges
-    for (const auto& [id, node] : graph->getNodes()) {
-        for (int succ : node.successors) {
-            dot << "  " << id << " -> " << succ;
-            
-            if (graph->isExceptionEdge(id, succ)) {
-                dot << " [color=red, style=dashed, label=\"exception\"]";
-            } 
-            // Remove or replace with alternative approach
-            // else if (simplifyGraph && graph->isBackEdge(id, succ)) {
-            else if (simplifyGraph && succ <= id) {  // Simple heuristic for back edges
-                dot << " [color=blue, style=bold]";
-            }
-            
-            dot << ";\n";
-        }
-    }
-    
-    dot << "}\n";
-    return dot.str();
+    std::string dot;
+    DotWriter writer(dot);
+    writer.reserve(DotWriter::estimateSize(graph->getNodeCount(), graph->getEdgeCount()));
+    writeDot(writer, *graph, showLineNumbers, simplifyGraph, highlightPaths);
+    return dot;
 }
 
 bool exportToDot(
@@ -99,7 +113,13 @@ bool exportToDot(
             return false;
         }
 
-        outFile << generateDotRepresentation(graph, showLineNumbers, simplifyGraph, highlightPaths);
+        // Straight to the file, without building the text in memory first
+        DotWriter writer(outFile);
+        writeDot(writer, *graph, showLineNumbers, simplifyGraph, highlightPaths);
+        if (!writer.flush()) {
+            qWarning() << "Failed to write file:" << filename.c_str();
+            return false;
+        }
         return true;
     } catch (const std::exception& e) {
         qCritical() << "Export failed:" << e.what();